@@ -1,178 +1,601 @@
 #include "Deriche.h"
+#include "ThreadPool.h"
+
+// Std includes
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+// Number of adjacent columns filtered together by the vertical IIR passes.
+// 16 floats are one cache line and fill one AVX-512 or two AVX2 registers.
+constexpr size_t kColumnBlock = 16;
+
+// Number of rows per work item of the horizontal IIR passes.
+constexpr int32_t kRowStripe = 8;
+
+//
+// Recursion steps shared by the column blocks and the full row sweeps. Every
+// step advances `lanes` independent recursions by one sample. The lanes are
+// adjacent in memory, so the loops are vectorized by the compiler.
+//
+
+// Y+(y) = I(y - 1) - b1 * Y+(y - 1) - b2 * Y+(y - 2); S(y) = a * Y+(y)
+// Y-(y) = I(y + 1) - b1 * Y-(y + 1) - b2 * Y-(y + 2); S(y) -= a * Y-(y)
+template < bool AntiCausal >
+inline void derivativeStep( const uint8_t* srcPtr, float* sPtr, float* y1,
+                            float* y2, size_t lanes,
+                            const DericheCoefficients& coeff )
+{
+    for ( size_t i = 0; i < lanes; i++ )
+    {
+        const float yn = srcPtr[ i ] - coeff.b1 * y1[ i ] - coeff.b2 * y2[ i ];
 
-void dericheX( const cv::Mat& imageIn, cv::Mat& imageOut, double alpha,
-               double omega )
+        if constexpr ( AntiCausal )
+        {
+            sPtr[ i ] -= coeff.a * yn;
+        }
+        else
+        {
+            sPtr[ i ] = coeff.a * yn;
+        }
+
+        y2[ i ] = y1[ i ];
+        y1[ i ] = yn;
+    }
+}
+
+// R+(y) = a0 * S(y) + a1 * S(y - 1) - b1 * R+(y - 1) - b2 * R+(y - 2)
+inline void smoothingCausalStep( const float* sPtr, const float* sPtrM1,
+                                 float* rpPtr, float* r1, float* r2,
+                                 size_t lanes,
+                                 const DericheCoefficients& coeff )
 {
-    // Implementation based on the paper from Richard Deriche:
-    // Using Canny's Criteria to derive a recursively implemented optimal edge
-    // detector
+    for ( size_t i = 0; i < lanes; i++ )
+    {
+        const float rp = coeff.a0 * sPtr[ i ] + coeff.a1 * sPtrM1[ i ] -
+                         coeff.b1 * r1[ i ] - coeff.b2 * r2[ i ];
+        rpPtr[ i ] = rp;
+        r2[ i ] = r1[ i ];
+        r1[ i ] = rp;
+    }
+}
 
-    //
-    // Calculate the required coefficients based on the paper
-    ////
-    /*const auto kDenom =
-        1.0 + 2.0 * alpha * std::exp( -alpha ) - std::exp( -2.0 + alpha );
-    const auto k =
-        std::pow( 1.0 - std::exp( -alpha ), 2 ) * std::pow( alpha, 2 ) / kDenom;
+// R-(y) = a2 * S(y + 1) + a3 * S(y + 2) - b1 * R-(y + 1) - b2 * R-(y + 2)
+// R(y)  = R+(y) + R-(y)
+//
+// S(y + 1) and S(y + 2) are carried in s1 and s2 and S(y) is read before R(y)
+// is written, so sPtr and dstPtr may point to the same memory.
+template < typename T >
+inline void smoothingAntiCausalStep( const float* sPtr, const float* rpPtr,
+                                     T* dstPtr, float* s1, float* s2,
+                                     float* r1, float* r2, size_t lanes,
+                                     const DericheCoefficients& coeff )
+{
+    for ( size_t i = 0; i < lanes; i++ )
+    {
+        const float rm = coeff.a2 * s1[ i ] + coeff.a3 * s2[ i ] -
+                         coeff.b1 * r1[ i ] - coeff.b2 * r2[ i ];
+        const float s = sPtr[ i ];
+        dstPtr[ i ] = cv::saturate_cast< T >( rpPtr[ i ] + rm );
+        s2[ i ] = s1[ i ];
+        s1[ i ] = s;
+        r2[ i ] = r1[ i ];
+        r1[ i ] = rm;
+    }
+}
 
-    const auto c = std::pow( 1.0 - std::exp( -alpha ), 2 ) / std::exp( -alpha
-    );*/
+/*
+ * Horizontal derivative pass of a single row.
+ *
+ * Y+(x) = I(x - 1) - b1 * Y+(x - 1) - b2 * Y+(x - 2)
+ * Y-(x) = I(x + 1) - b1 * Y-(x + 1) - b2 * Y-(x + 2)
+ * S(x)  = a * (Y+(x) - Y-(x))
+ *
+ * @param [in]  srcPtr  The input row
+ * @param [out] sPtr    The output row receiving S
+ * @param [in]  width   The number of pixels in the row
+ * @param [in]  coeff   The filter coefficients
+ */
+void derivativeRow( const uint8_t* srcPtr, float* sPtr, int32_t width,
+                    const DericheCoefficients& coeff )
+{
+    // Left to right
+    float y2 = 0.0f;
+    float y1 = srcPtr[ 0 ];
+    sPtr[ 0 ] = coeff.a * y1;
 
-    const auto kDenom = 2.0 * alpha * std::exp( -alpha ) * std::sin( omega ) +
-                        omega - omega * std::exp( -2.0 * alpha );
+    for ( int32_t x = 1; x < width; x++ )
+    {
+        const float yp = srcPtr[ x - 1 ] - coeff.b1 * y1 - coeff.b2 * y2;
+        sPtr[ x ] = coeff.a * yp;
+        y2 = y1;
+        y1 = yp;
+    }
 
-    const auto k = ( 1.0 - 2.0 * std::exp( -alpha ) * std::cos( omega ) +
-                     std::exp( -2.0 * alpha ) ) *
-                   ( std::pow( alpha, 2 ) + std::pow( omega, 2 ) ) / kDenom;
+    // Right to left
+    y2 = 0.0f;
+    y1 = srcPtr[ width - 1 ];
+    sPtr[ width - 1 ] -= coeff.a * y1;
 
-    const auto c = ( 1.0 - 2.0 * std::exp( -alpha ) * std::cos( omega ) +
-                     std::exp( -2 * alpha ) ) /
-                   ( std::exp( -alpha ) * std::sin( omega ) );
+    for ( int32_t x = width - 2; x >= 0; x-- )
+    {
+        const float ym = srcPtr[ x + 1 ] - coeff.b1 * y1 - coeff.b2 * y2;
+        sPtr[ x ] -= coeff.a * ym;
+        y2 = y1;
+        y1 = ym;
+    }
+}
 
-    const auto a = -c * std::exp( -alpha ) * std::sin( omega );
-    const auto b1 = -2.0 * std::exp( -alpha ) * std::cos( omega );
-    const auto b2 = std::exp( -2 * alpha );
-    const auto c1 = k * alpha / ( std::pow( alpha, 2 ) + std::pow( omega, 2 ) );
-    const auto c2 = k * omega / ( std::pow( alpha, 2 ) + std::pow( omega, 2 ) );
-    const auto a0 = c2;
-    const auto a1 = ( -c2 * std::cos( omega ) + c1 * std::sin( omega ) ) *
-                    std::exp( -alpha );
-    const auto a2 = a1 - c2 * b1;
-    const auto a3 = -c2 * b2;
+/*
+ * Horizontal smoothing pass of a single row.
+ *
+ * R+(x) = a0 * S(x) + a1 * S(x - 1) - b1 * R+(x - 1) - b2 * R+(x - 2)
+ * R-(x) = a2 * S(x + 1) + a3 * S(x + 2) - b1 * R-(x + 1) - b2 * R-(x + 2)
+ * R(x)  = R+(x) + R-(x)
+ *
+ * @param [in]  sPtr    The input row, may be the same memory as dstPtr
+ * @param [in]  rpPtr   Scratch row receiving R+
+ * @param [out] dstPtr  The output row receiving R
+ * @param [in]  width   The number of pixels in the row
+ * @param [in]  coeff   The filter coefficients
+ */
+template < typename T >
+void smoothingRow( const float* sPtr, float* rpPtr, T* dstPtr, int32_t width,
+                   const DericheCoefficients& coeff )
+{
+    // Left to right
+    float r2 = 0.0f;
+    float r1 = coeff.a0 * sPtr[ 0 ];
+    rpPtr[ 0 ] = r1;
 
-    imageOut = cv::Mat( imageIn.size( ), CV_32FC1, cv::Scalar::all( 0.0f ) );
-    cv::Mat YP = imageOut.clone( ); // We just need one line
-    cv::Mat YM = imageOut.clone( ); // We just need one line
-    cv::Mat imageS = imageOut.clone( );
+    for ( int32_t x = 1; x < width; x++ )
+    {
+        const float rp = coeff.a0 * sPtr[ x ] + coeff.a1 * sPtr[ x - 1 ] -
+                         coeff.b1 * r1 - coeff.b2 * r2;
+        rpPtr[ x ] = rp;
+        r2 = r1;
+        r1 = rp;
+    }
 
-    const auto width = imageIn.size( ).width;
-    const auto height = imageIn.size( ).height;
+    // Right to left
+    float s2 = 0.0f;
+    float s1 = sPtr[ width - 1 ];
+    r2 = 0.0f;
+    r1 = s1;
+    dstPtr[ width - 1 ] = cv::saturate_cast< T >( rpPtr[ width - 1 ] + r1 );
 
-    // X rows -> horizontal IIR filter
-    for ( int32_t y = 0; y < height; y++ )
+    for ( int32_t x = width - 2; x >= 0; x-- )
     {
-        auto srcPtr = imageIn.ptr< uint8_t >( y );
-        auto sPtr = imageS.ptr< float >( y );
-        auto ypPtr = YP.ptr< float >( y );
-        auto ymPtr = YM.ptr< float >( y );
+        const float rm = coeff.a2 * s1 + coeff.a3 * s2 - coeff.b1 * r1 -
+                         coeff.b2 * r2;
+        const float s = sPtr[ x ];
+        dstPtr[ x ] = cv::saturate_cast< T >( rpPtr[ x ] + rm );
+        s2 = s1;
+        s1 = s;
+        r2 = r1;
+        r1 = rm;
+    }
+}
 
-        // Left to right
-        // Y+(x, y) = I(x - 1, y) - b1 * Y+(x - 1, y) - b2 * Y+(x - 2, y)
-        int32_t x = 0;
-        ypPtr[ x ] = *srcPtr;
+/*
+ * Vertical smoothing pass over Lanes adjacent columns starting at column x0.
+ * Each lane runs the same recursion as smoothingRow.
+ *
+ * @param [in]  imageS      The input image (CV_32FC1), may be imageOut
+ * @param [in]  rpBlock     Scratch receiving R+, height * Lanes floats
+ * @param [out] imageOut    The output image receiving R
+ * @param [in]  x0          The first column of the block
+ * @param [in]  coeff       The filter coefficients
+ */
+template < size_t Lanes, typename T >
+void smoothingColumns( const cv::Mat& imageS, float* rpBlock,
+                       cv::Mat& imageOut, int32_t x0,
+                       const DericheCoefficients& coeff )
+{
+    const auto height = imageS.rows;
 
-        x++;
-        srcPtr++;
-        ypPtr[ x ] = srcPtr[ x - 1 ] - b1 * ypPtr[ x - 1 ];
+    std::array< float, Lanes > r1 { };
+    std::array< float, Lanes > r2 { };
 
-        x++;
-        srcPtr++;
+    // Top to bottom
+    {
+        const auto sPtr = imageS.ptr< float >( 0 ) + x0;
 
-        for ( ; x < width; x++, srcPtr++ )
+        for ( size_t i = 0; i < Lanes; i++ )
         {
-            ypPtr[ x ] =
-                srcPtr[ -1 ] - b1 * ypPtr[ x - 1 ] - b2 * ypPtr[ x - 2 ];
+            r1[ i ] = coeff.a0 * sPtr[ i ];
+            rpBlock[ i ] = r1[ i ];
         }
+    }
 
-        // Right to left
-        // Y-(x, y) = I(x + 1, y) - b1 * Y-(x + 1, y) - b2 * Y-(x + 2, y)
-        srcPtr = imageIn.ptr< uint8_t >( y );
-        srcPtr += width - 1;
-
-        x = width - 1;
-        ymPtr[ x ] = srcPtr[ x ];
-
-        x--;
-        srcPtr--;
-        ymPtr[ x ] = srcPtr[ x + 1 ] - b1 * ymPtr[ x + 1 ];
+    for ( int32_t y = 1; y < height; y++ )
+    {
+        smoothingCausalStep( imageS.ptr< float >( y ) + x0,
+                             imageS.ptr< float >( y - 1 ) + x0,
+                             rpBlock + static_cast< size_t >( y ) * Lanes,
+                             r1.data( ),
+                             r2.data( ),
+                             Lanes,
+                             coeff );
+    }
 
-        x--;
-        srcPtr--;
+    // Bottom to top
+    std::array< float, Lanes > s1 { };
+    std::array< float, Lanes > s2 { };
+    r2.fill( 0.0f );
 
-        for ( ; x >= 0; x--, srcPtr-- )
-        {
-            ymPtr[ x ] =
-                srcPtr[ 1 ] - b1 * ymPtr[ x + 1 ] - b2 * ymPtr[ x + 2 ];
-        }
+    {
+        const auto sPtr = imageS.ptr< float >( height - 1 ) + x0;
+        const auto rpPtr =
+            rpBlock + static_cast< size_t >( height - 1 ) * Lanes;
+        const auto dstPtr = imageOut.ptr< T >( height - 1 ) + x0;
 
-        for ( x = 0; x < width; x++ )
+        for ( size_t i = 0; i < Lanes; i++ )
         {
-            sPtr[ x ] = a * ( ypPtr[ x ] - ymPtr[ x ] );
+            s1[ i ] = sPtr[ i ];
+            r1[ i ] = s1[ i ];
+            dstPtr[ i ] = cv::saturate_cast< T >( rpPtr[ i ] + r1[ i ] );
         }
     }
 
-    // X cols
-    cv::Mat RP = cv::Mat( 1, height, CV_32FC1, cv::Scalar::all( 0.0f ) );
-    cv::Mat RM = cv::Mat( 1, height, CV_32FC1, cv::Scalar::all( 0.0f ) );
+    for ( int32_t y = height - 2; y >= 0; y-- )
+    {
+        smoothingAntiCausalStep( imageS.ptr< float >( y ) + x0,
+                                 rpBlock + static_cast< size_t >( y ) * Lanes,
+                                 imageOut.ptr< T >( y ) + x0,
+                                 s1.data( ),
+                                 s2.data( ),
+                                 r1.data( ),
+                                 r2.data( ),
+                                 Lanes,
+                                 coeff );
+    }
+}
 
-    // const auto stride = imageS.step[ 0 ];
+/*
+ * Runs a column kernel over the columns [x0, x1) in blocks of kColumnBlock
+ * columns. The columns right of the last full block are filtered one by one,
+ * which keeps every column in exactly one block and allows in place filters.
+ * As long as x0 is a multiple of kColumnBlock, the blocks of a column range
+ * are the same as the blocks of the whole image.
+ *
+ * @param [in]  x0      The first column
+ * @param [in]  x1      The column behind the last column
+ * @param [in]  kernel  Callable taking the block start and a lane tag
+ */
+template < typename Kernel >
+void forEachColumnBlock( int32_t x0, int32_t x1, Kernel&& kernel )
+{
+    constexpr auto blockWidth = static_cast< int32_t >( kColumnBlock );
 
-    auto rpPtr = RP.ptr< float >( 0 );
-    auto rmPtr = RM.ptr< float >( 0 );
+    for ( ; x0 + blockWidth <= x1; x0 += blockWidth )
+    {
+        kernel( x0, std::integral_constant< size_t, kColumnBlock > { } );
+    }
 
-    for ( int32_t x = 0; x < width; x++ )
+    for ( ; x0 < x1; x0++ )
     {
-        // Top to bottom
-        // R+(x, y) = a0 * S(x, y) + a1 * S(x, y - 1) - b1 * R+(x, y - 1) - b2 *
-        // R+(x, y - 2)
+        kernel( x0, std::integral_constant< size_t, 1 > { } );
+    }
+}
 
-        auto sPtr = imageS.ptr< float >( 0 );
+/*
+ * Vertical smoothing of all columns of imageS into imageOut. The columns are
+ * distributed in whole blocks over the thread pool.
+ *
+ * @param [in]  imageS      The input image (CV_32FC1), may be imageOut
+ * @param [out] imageOut    The output image receiving R
+ * @param [in]  coeff       The filter coefficients
+ * @param [in]  threadPool  The thread pool or nullptr
+ */
+template < typename T >
+void smoothingColumnsAll( const cv::Mat& imageS, cv::Mat& imageOut,
+                          const DericheCoefficients& coeff,
+                          ThreadPool* threadPool )
+{
+    parallelFor( threadPool,
+                 0,
+                 imageS.cols,
+                 static_cast< int32_t >( kColumnBlock ),
+                 [ & ]( int32_t x0, int32_t x1 )
+                 {
+                     std::vector< float > rpBlock(
+                         static_cast< size_t >( imageS.rows ) * kColumnBlock );
+
+                     forEachColumnBlock(
+                         x0,
+                         x1,
+                         [ & ]( int32_t xb, auto lanes )
+                         {
+                             smoothingColumns< decltype( lanes )::value, T >(
+                                 imageS, rpBlock.data( ), imageOut, xb, coeff );
+                         } );
+                 } );
+}
 
-        // Move to current column
-        sPtr += x;
+/*
+ * Horizontal smoothing of all rows of imageS into imageOut. The rows are
+ * distributed in stripes over the thread pool.
+ *
+ * @param [in]  imageS      The input image (CV_32FC1), may be imageOut
+ * @param [out] imageOut    The output image receiving R
+ * @param [in]  coeff       The filter coefficients
+ * @param [in]  threadPool  The thread pool or nullptr
+ */
+template < typename T >
+void smoothingRowsAll( const cv::Mat& imageS, cv::Mat& imageOut,
+                       const DericheCoefficients& coeff,
+                       ThreadPool* threadPool )
+{
+    parallelFor( threadPool,
+                 0,
+                 imageS.rows,
+                 kRowStripe,
+                 [ & ]( int32_t y0, int32_t y1 )
+                 {
+                     std::vector< float > rpRow(
+                         static_cast< size_t >( imageS.cols ) );
+
+                     for ( int32_t y = y0; y < y1; y++ )
+                     {
+                         smoothingRow( imageS.ptr< float >( y ),
+                                       rpRow.data( ),
+                                       imageOut.ptr< T >( y ),
+                                       imageS.cols,
+                                       coeff );
+                     }
+                 } );
+}
 
-        int32_t y = 0;
-        rpPtr[ y ] = a0 * *sPtr;
+/*
+ * Horizontal derivative of all rows of imageIn into imageS. The rows are
+ * distributed in stripes over the thread pool.
+ *
+ * @param [in]  imageIn     The input image (CV_8UC1)
+ * @param [out] imageS      The output image receiving S (CV_32FC1)
+ * @param [in]  coeff       The filter coefficients
+ * @param [in]  threadPool  The thread pool or nullptr
+ */
+void derivativeRowsAll( const cv::Mat& imageIn, cv::Mat& imageS,
+                        const DericheCoefficients& coeff,
+                        ThreadPool* threadPool )
+{
+    parallelFor( threadPool,
+                 0,
+                 imageIn.rows,
+                 kRowStripe,
+                 [ & ]( int32_t y0, int32_t y1 )
+                 {
+                     for ( int32_t y = y0; y < y1; y++ )
+                     {
+                         derivativeRow( imageIn.ptr< uint8_t >( y ),
+                                        imageS.ptr< float >( y ),
+                                        imageIn.cols,
+                                        coeff );
+                     }
+                 } );
+}
 
-        y++;
-        sPtr += width;
+/*
+ * Vertical derivative of the columns [x0, x1) with two sweeps over the input
+ * rows. All columns of the range run as independent lanes of the recursion
+ * of derivativeRow, the lanes are adjacent in memory and vectorized. The top
+ * to bottom sweep calls onRow( y ) after row y is processed, which lets the
+ * caller fuse a row pass into the same sweep over the input.
+ *
+ * @param [in]  imageIn The input image (CV_8UC1)
+ * @param [out] imageS  The output image receiving S (CV_32FC1)
+ * @param [in]  x0      The first column
+ * @param [in]  x1      The column behind the last column
+ * @param [in]  coeff   The filter coefficients
+ * @param [in]  onRow   Callable taking the row index
+ */
+template < typename RowFunction >
+void derivativeColumns( const cv::Mat& imageIn, cv::Mat& imageS, int32_t x0,
+                        int32_t x1, const DericheCoefficients& coeff,
+                        RowFunction&& onRow )
+{
+    const auto height = imageIn.rows;
+    const auto lanes = static_cast< size_t >( x1 - x0 );
 
-        rpPtr[ y ] = a0 * *sPtr + a1 * sPtr[ -width ] - b1 * rpPtr[ y - 1 ];
+    std::vector< float > y1( lanes );
+    std::vector< float > y2( lanes, 0.0f );
 
-        y++;
-        sPtr += width;
+    // Top to bottom
+    {
+        const auto srcPtr = imageIn.ptr< uint8_t >( 0 ) + x0;
+        const auto sPtr = imageS.ptr< float >( 0 ) + x0;
 
-        for ( ; y < height; y++, sPtr += width )
+        for ( size_t i = 0; i < lanes; i++ )
         {
-            rpPtr[ y ] = a0 * *sPtr + a1 * sPtr[ -width ] -
-                         b1 * rpPtr[ y - 1 ] - b2 * rpPtr[ y - 2 ];
+            y1[ i ] = srcPtr[ i ];
+            sPtr[ i ] = coeff.a * y1[ i ];
         }
 
-        // Bottom to top
-        // R-(x, y) = a2 * S(x, y + 1) + a3 * S(x, y + 2) - b1 * R-(x, y + 1) -
-        // b2 * R-(x, y + 2)
-        sPtr = imageS.ptr< float >( height - 1 );
-        sPtr += x;
+        onRow( 0 );
+    }
 
-        y = height - 1;
-        rmPtr[ y ] = *sPtr;
+    for ( int32_t y = 1; y < height; y++ )
+    {
+        derivativeStep< false >( imageIn.ptr< uint8_t >( y - 1 ) + x0,
+                                 imageS.ptr< float >( y ) + x0,
+                                 y1.data( ),
+                                 y2.data( ),
+                                 lanes,
+                                 coeff );
+
+        onRow( y );
+    }
 
-        y--;
-        sPtr -= width;
-        rmPtr[ y ] = a2 * sPtr[ width ] - b1 + rmPtr[ y + 1 ];
+    // Bottom to top
+    std::fill( y2.begin( ), y2.end( ), 0.0f );
 
-        y--;
-        sPtr -= width;
+    {
+        const auto srcPtr = imageIn.ptr< uint8_t >( height - 1 ) + x0;
+        const auto sPtr = imageS.ptr< float >( height - 1 ) + x0;
 
-        for ( ; y >= 0; y--, sPtr -= width )
+        for ( size_t i = 0; i < lanes; i++ )
         {
-            rmPtr[ y ] = a2 * sPtr[ width ] + a3 * sPtr[ 2 * width ] -
-                         b1 * rmPtr[ y + 1 ] - b2 * rmPtr[ y + 2 ];
+            y1[ i ] = srcPtr[ i ];
+            sPtr[ i ] -= coeff.a * y1[ i ];
         }
+    }
+
+    for ( int32_t y = height - 2; y >= 0; y-- )
+    {
+        derivativeStep< true >( imageIn.ptr< uint8_t >( y + 1 ) + x0,
+                                imageS.ptr< float >( y ) + x0,
+                                y1.data( ),
+                                y2.data( ),
+                                lanes,
+                                coeff );
+    }
+}
+
+/*
+ * Vertical derivative of all columns of imageIn into imageS. The columns are
+ * distributed in ranges over the thread pool.
+ *
+ * @param [in]  imageIn     The input image (CV_8UC1)
+ * @param [out] imageS      The output image receiving S (CV_32FC1)
+ * @param [in]  coeff       The filter coefficients
+ * @param [in]  threadPool  The thread pool or nullptr
+ */
+void derivativeColumnsAll( const cv::Mat& imageIn, cv::Mat& imageS,
+                           const DericheCoefficients& coeff,
+                           ThreadPool* threadPool )
+{
+    parallelFor( threadPool,
+                 0,
+                 imageIn.cols,
+                 static_cast< int32_t >( kColumnBlock ),
+                 [ & ]( int32_t x0, int32_t x1 )
+                 {
+                     derivativeColumns(
+                         imageIn, imageS, x0, x1, coeff, []( int32_t ) { } );
+                 } );
+}
+
+/*
+ * Computes S for both derivatives. Without a thread pool the input rows are
+ * swept only twice: the top to bottom sweep runs the horizontal derivative of
+ * each row together with the causal vertical derivative for all columns, the
+ * bottom to top sweep the anti causal vertical derivative. With a thread pool
+ * the horizontal pass runs on row stripes and the vertical pass on column
+ * ranges. Every sample is computed by the same expression in both cases.
+ *
+ * @param [in]  imageIn     The input image (CV_8UC1)
+ * @param [out] imageSX     The horizontal derivative pass (CV_32FC1)
+ * @param [out] imageSY     The vertical derivative pass (CV_32FC1)
+ * @param [in]  coeff       The filter coefficients
+ * @param [in]  threadPool  The thread pool or nullptr
+ */
+void derivativePassesXY( const cv::Mat& imageIn, cv::Mat& imageSX,
+                         cv::Mat& imageSY, const DericheCoefficients& coeff,
+                         ThreadPool* threadPool )
+{
+    if ( threadPool == nullptr || threadPool->size( ) == 1 )
+    {
+        derivativeColumns( imageIn,
+                           imageSY,
+                           0,
+                           imageIn.cols,
+                           coeff,
+                           [ & ]( int32_t y )
+                           {
+                               derivativeRow( imageIn.ptr< uint8_t >( y ),
+                                              imageSX.ptr< float >( y ),
+                                              imageIn.cols,
+                                              coeff );
+                           } );
+        return;
+    }
+
+    derivativeRowsAll( imageIn, imageSX, coeff, threadPool );
+    derivativeColumnsAll( imageIn, imageSY, coeff, threadPool );
+}
+
+template < typename T >
+void dericheXYImpl( const cv::Mat& imageIn, cv::Mat& imageOutX,
+                    cv::Mat& imageOutY, const DericheCoefficients& coeff,
+                    ThreadPool* threadPool )
+{
+    // Float output holds the intermediate S planes itself and is smoothed in
+    // place. Any other depth needs two float planes for S.
+    cv::Mat imageSX;
+    cv::Mat imageSY;
+
+    if constexpr ( std::is_same_v< T, float > )
+    {
+        imageSX = imageOutX;
+        imageSY = imageOutY;
+    }
+    else
+    {
+        imageSX.create( imageIn.size( ), CV_32FC1 );
+        imageSY.create( imageIn.size( ), CV_32FC1 );
+    }
 
-        for ( y = 0; y < height; y++ )
+    derivativePassesXY( imageIn, imageSX, imageSY, coeff, threadPool );
+
+    // X cols -> vertical IIR filter
+    smoothingColumnsAll< T >( imageSX, imageOutX, coeff, threadPool );
+
+    // Y rows -> horizontal IIR filter
+    smoothingRowsAll< T >( imageSY, imageOutY, coeff, threadPool );
+}
+
+// Small least recently used cache of coefficient sets. Only a handful of
+// (alpha, omega) pairs are in use at the same time, so a linear search over a
+// short list is all that is needed.
+class CoefficientCache
+{
+public:
+    DericheCoefficients get( double alpha, double omega )
+    {
+        std::lock_guard< std::mutex > lock( mMutex );
+
+        const auto it = std::find_if(
+            mEntries.begin( ),
+            mEntries.end( ),
+            [ & ]( const DericheCoefficients& entry )
+            { return entry.alpha == alpha && entry.omega == omega; } );
+
+        if ( it != mEntries.end( ) )
+        {
+            // Move the hit to the front
+            mEntries.splice( mEntries.begin( ), mEntries, it );
+        }
+        else
         {
-            auto dstPtr = imageOut.ptr< float >( y );
-            dstPtr += x;
-            *dstPtr = rmPtr[ y ] + rpPtr[ y ];
+            mEntries.push_front( calculateDericheCoefficients( alpha, omega ) );
+
+            if ( mEntries.size( ) > kCapacity )
+            {
+                mEntries.pop_back( );
+            }
         }
+
+        return mEntries.front( );
     }
 
-    // Y rows -> vertical IIR filter
-}
+private:
+    static constexpr size_t kCapacity = 16;
 
-void dericheY( const cv::Mat& imageIn, cv::Mat& imageOut, double alpha,
-               double omega )
+    std::mutex mMutex;
+
+    std::list< DericheCoefficients > mEntries;
+};
+} // namespace
+
+DericheCoefficients calculateDericheCoefficients( double alpha, double omega )
 {
     // Implementation based on the paper from Richard Deriche:
     // Using Canny's Criteria to derive a recursively implemented optimal edge
@@ -211,16 +634,59 @@ void dericheY( const cv::Mat& imageIn, cv::Mat& imageOut, double alpha,
     const auto a2 = a1 - c2 * b1;
     const auto a3 = -c2 * b2;
 
-    const auto width = imageIn.size( ).width;
-    const auto height = imageIn.size( ).height;
+    DericheCoefficients coeff;
+    coeff.alpha = alpha;
+    coeff.omega = omega;
+    coeff.a = static_cast< float >( a );
+    coeff.b1 = static_cast< float >( b1 );
+    coeff.b2 = static_cast< float >( b2 );
+    coeff.a0 = static_cast< float >( a0 );
+    coeff.a1 = static_cast< float >( a1 );
+    coeff.a2 = static_cast< float >( a2 );
+    coeff.a3 = static_cast< float >( a3 );
+
+    return coeff;
+}
 
-    imageOut = cv::Mat( imageIn.size( ), CV_32FC1, cv::Scalar::all( 0.0f ) );
-    cv::Mat YP = cv::Mat( 1, height, CV_32FC1, cv::Scalar::all( 0.0f ) );
-    cv::Mat YM = cv::Mat( 1, height, CV_32FC1, cv::Scalar::all( 0.0f ) );
-    cv::Mat imageS = imageOut.clone( );
+DericheCoefficients getDericheCoefficients( double alpha, double omega )
+{
+    static CoefficientCache cache;
 
-    auto ypPtr = YP.ptr< float >( 0 );
-    auto ymPtr = YM.ptr< float >( 0 );
+    return cache.get( alpha, omega );
+}
+
+void dericheX( const cv::Mat& imageIn, cv::Mat& imageOut, double alpha,
+               double omega, ThreadPool* threadPool )
+{
+    dericheX(
+        imageIn, imageOut, getDericheCoefficients( alpha, omega ), threadPool );
+}
+
+void dericheX( const cv::Mat& imageIn, cv::Mat& imageOut,
+               const DericheCoefficients& coeff, ThreadPool* threadPool )
+{
+    imageOut.create( imageIn.size( ), CV_32FC1 );
+    cv::Mat imageS( imageIn.size( ), CV_32FC1 );
+
+    // X rows -> horizontal IIR filter, row stripes in parallel
+    derivativeRowsAll( imageIn, imageS, coeff, threadPool );
+
+    // X cols -> vertical IIR filter, kColumnBlock columns at once
+    smoothingColumnsAll< float >( imageS, imageOut, coeff, threadPool );
+}
+
+void dericheY( const cv::Mat& imageIn, cv::Mat& imageOut, double alpha,
+               double omega, ThreadPool* threadPool )
+{
+    dericheY(
+        imageIn, imageOut, getDericheCoefficients( alpha, omega ), threadPool );
+}
+
+void dericheY( const cv::Mat& imageIn, cv::Mat& imageOut,
+               const DericheCoefficients& coeff, ThreadPool* threadPool )
+{
+    imageOut.create( imageIn.size( ), CV_32FC1 );
+    cv::Mat imageS( imageIn.size( ), CV_32FC1 );
 
     // IIR Filter
 
@@ -233,57 +699,8 @@ void dericheY( const cv::Mat& imageIn, cv::Mat& imageOut, double alpha,
     // S(x, y) = a * (Y+(x, y) - Y-(x, y)
     // for x = 0 ... M - 1; y = 0 ... N - 1
 
-    // Y cols -> vertical IIR filter
-    for ( int32_t x = 0; x < width; x++ )
-    {
-        // Top to bottom
-        auto srcPtr = imageIn.ptr< uint8_t >( 0 );
-        auto sPtr = imageS.ptr< float >( 0 );
-
-        srcPtr += x;
-        sPtr += x;
-
-        int32_t y = 0;
-        ypPtr[ y ] = *srcPtr;
-
-        y++;
-        srcPtr += width;
-        ypPtr[ y ] = srcPtr[ -width ] - b1 * ypPtr[ y - 1 ];
-
-        y++;
-        srcPtr += width;
-
-        for ( ; y < height; y++, srcPtr += width )
-        {
-            ypPtr[ y ] =
-                srcPtr[ -width ] - b1 * ypPtr[ y - 1 ] - b2 * ypPtr[ y - 2 ];
-        }
-
-        // Bottom to top
-        srcPtr = imageIn.ptr< uint8_t >( height - 1 );
-        srcPtr += x;
-
-        y = height - 1;
-        ymPtr[ y ] = *srcPtr;
-
-        y--;
-        srcPtr -= width;
-        ymPtr[ y ] = srcPtr[ width ] - b1 * ymPtr[ y + 1 ];
-
-        y--;
-        srcPtr -= width;
-
-        for ( ; y >= 0; y--, srcPtr -= width )
-        {
-            ymPtr[ y ] =
-                srcPtr[ width ] - b1 * ymPtr[ y + 1 ] - b2 * ymPtr[ y + 2 ];
-        }
-
-        for ( y = 0; y < height; y++, sPtr += width )
-        {
-            *sPtr = a * ( ypPtr[ y ] - ymPtr[ y ] );
-        }
-    }
+    // Y cols -> vertical IIR filter, column ranges in parallel
+    derivativeColumnsAll( imageIn, imageS, coeff, threadPool );
 
     // Y rows
 
@@ -298,58 +715,42 @@ void dericheY( const cv::Mat& imageIn, cv::Mat& imageOut, double alpha,
     // R(x, y) = R-(x, y) + R+(x, y)
     // for x = 0 ... M - 1; y = 0 ... N - 1
 
-    cv::Mat RP = cv::Mat( 1, width, CV_32FC1, cv::Scalar::all( 0.0f ) );
-    cv::Mat RM = cv::Mat( 1, width, CV_32FC1, cv::Scalar::all( 0.0f ) );
-
-    auto rpPtr = RP.ptr< float >( 0 );
-    auto rmPtr = RM.ptr< float >( 0 );
-
-    for ( int32_t y = 0; y < height; y++ )
-    {
-        // Left to right
-        auto dstPtr = imageOut.ptr< float >( y );
-        auto sPtr = imageS.ptr< float >( y );
-
-        int32_t x = 0;
-        rpPtr[ x ] = a0 * *sPtr;
-
-        x++;
-        sPtr++;
-        rpPtr[ x ] = a0 * sPtr[ 0 ] + a1 * sPtr[ -1 ] - b1 * rpPtr[ x - 1 ];
-
-        x++;
-        sPtr++;
-
-        for ( ; x < width; x++, sPtr++ )
-        {
-            rpPtr[ x ] = a0 * sPtr[ 0 ] + a1 * sPtr[ -1 ] -
-                         b1 * rpPtr[ x - 1 ] - b2 * rpPtr[ x - 2 ];
-        }
-
-        // Right to left
-        sPtr = imageS.ptr< float >( y );
-
-        sPtr += width - 1;
+    smoothingRowsAll< float >( imageS, imageOut, coeff, threadPool );
+}
 
-        x = width - 1;
-        rmPtr[ x ] = *sPtr;
+void dericheXY( const cv::Mat& imageIn, cv::Mat& imageOutX, cv::Mat& imageOutY,
+                double alpha, double omega, int32_t ddepth,
+                ThreadPool* threadPool )
+{
+    dericheXY( imageIn,
+               imageOutX,
+               imageOutY,
+               getDericheCoefficients( alpha, omega ),
+               ddepth,
+               threadPool );
+}
 
-        x--;
-        sPtr--;
-        rmPtr[ x ] = a2 * sPtr[ 1 ] - b1 * rmPtr[ x + 1 ];
+void dericheXY( const cv::Mat& imageIn, cv::Mat& imageOutX, cv::Mat& imageOutY,
+                const DericheCoefficients& coeff, int32_t ddepth,
+                ThreadPool* threadPool )
+{
+    CV_Assert( imageIn.type( ) == CV_8UC1 );
 
-        x--;
-        sPtr--;
+    imageOutX.create( imageIn.size( ), CV_MAKETYPE( ddepth, 1 ) );
+    imageOutY.create( imageIn.size( ), CV_MAKETYPE( ddepth, 1 ) );
 
-        for ( ; x >= 0; x--, sPtr-- )
-        {
-            rmPtr[ x ] = a2 * sPtr[ 1 ] + a3 * sPtr[ 2 ] - b1 * rmPtr[ x + 1 ] -
-                         b2 * rmPtr[ x + 2 ];
-        }
-
-        for ( x = 0; x < width; x++ )
-        {
-            dstPtr[ x ] = rmPtr[ x ] + rpPtr[ x ];
-        }
+    switch ( ddepth )
+    {
+    case CV_32F:
+        dericheXYImpl< float >(
+            imageIn, imageOutX, imageOutY, coeff, threadPool );
+        break;
+    case CV_16S:
+        dericheXYImpl< int16_t >(
+            imageIn, imageOutX, imageOutY, coeff, threadPool );
+        break;
+    default:
+        throw std::invalid_argument(
+            "dericheXY supports CV_16S and CV_32F output only" );
     }
-}
\ No newline at end of file
+}
@@ -3,8 +3,85 @@
 // OpenCV includes
 #include <opencv2/core.hpp>
 
+class ThreadPool;
+
+/*
+ * The coefficients of the Deriche derivative and smoothing recursions for one
+ * (alpha, omega) pair. Computing them takes a dozen transcendental function
+ * calls, so a set should be computed once and passed to the filters.
+ */
+struct DericheCoefficients
+{
+    double alpha { };
+    double omega { };
+
+    float a { };
+    float b1 { };
+    float b2 { };
+    float a0 { };
+    float a1 { };
+    float a2 { };
+    float a3 { };
+};
+
+/*
+ * Function that calculates the coefficients for the given alpha and omega.
+ *
+ * @param [in]  alpha   The Deriche alpha
+ * @param [in]  omega   The Deriche omega
+ * @returns The coefficients
+ */
+DericheCoefficients calculateDericheCoefficients( double alpha, double omega );
+
+/*
+ * Function that returns the coefficients for the given alpha and omega from a
+ * small thread safe LRU cache. They are only calculated on a cache miss.
+ *
+ * @param [in]  alpha   The Deriche alpha
+ * @param [in]  omega   The Deriche omega
+ * @returns The coefficients
+ */
+DericheCoefficients getDericheCoefficients( double alpha, double omega );
+
+// Without a thread pool the filters run on the calling thread. With a thread
+// pool the row passes are split into row stripes and the column passes into
+// column blocks. The result is bit identical to the serial filter.
+// The overloads taking alpha and omega use getDericheCoefficients.
 void dericheX( const cv::Mat& imageIn, cv::Mat& imageOut, double alpha,
-               double omega );
+               double omega, ThreadPool* threadPool = nullptr );
+
+void dericheX( const cv::Mat& imageIn, cv::Mat& imageOut,
+               const DericheCoefficients& coeff,
+               ThreadPool* threadPool = nullptr );
 
 void dericheY( const cv::Mat& imageIn, cv::Mat& imageOut, double alpha,
-               double omega );
\ No newline at end of file
+               double omega, ThreadPool* threadPool = nullptr );
+
+void dericheY( const cv::Mat& imageIn, cv::Mat& imageOut,
+               const DericheCoefficients& coeff,
+               ThreadPool* threadPool = nullptr );
+
+/*
+ * Function that calculates both Deriche derivatives in one go. The input rows
+ * are read once for both directions and the results are written directly to
+ * the output images in the requested depth. Existing output buffers of the
+ * right size and type are reused.
+ *
+ * With CV_32F the output images hold the intermediate results, so no other
+ * full frame buffer is allocated. CV_16S needs two float working planes.
+ *
+ * @param [in]  imageIn     The input image (CV_8UC1)
+ * @param [out] imageOutX   The derivative in x direction
+ * @param [out] imageOutY   The derivative in y direction
+ * @param [in]  alpha       The Deriche alpha
+ * @param [in]  omega       The Deriche omega
+ * @param [in]  ddepth      The output depth, CV_16S or CV_32F
+ * @param [in]  threadPool  Optional thread pool, see dericheX
+ */
+void dericheXY( const cv::Mat& imageIn, cv::Mat& imageOutX, cv::Mat& imageOutY,
+                double alpha, double omega, int32_t ddepth = CV_32F,
+                ThreadPool* threadPool = nullptr );
+
+void dericheXY( const cv::Mat& imageIn, cv::Mat& imageOutX, cv::Mat& imageOutY,
+                const DericheCoefficients& coeff, int32_t ddepth = CV_32F,
+                ThreadPool* threadPool = nullptr );
\ No newline at end of file
@@ -0,0 +1,482 @@
+#include "EdgeBitmap.h"
+
+// Std includes
+#include <algorithm>
+#include <array>
+#include <bitset>
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+namespace
+{
+constexpr int32_t kWordBits = 64;
+
+// The index of the lowest set bit, word must not be 0
+inline int32_t lowestBit( uint64_t word )
+{
+#if defined( _MSC_VER )
+    unsigned long index;
+    _BitScanForward64( &index, word );
+    return static_cast< int32_t >( index );
+#else
+    return __builtin_ctzll( word );
+#endif
+}
+
+/*
+ * Function that builds the table of the redundant neighbourhoods. The table
+ * is indexed by the neighbours packed like EdgeBitmap::neighbours. Adjacent
+ * ring positions touch, and every 4 neighbour also touches the next 4
+ * neighbour over the corner between them.
+ *
+ * @returns 1 for the neighbourhoods that make the center pixel redundant
+ */
+constexpr std::array< uint8_t, 256 > redundantTable( )
+{
+    std::array< uint8_t, 256 > table { };
+
+    for ( size_t index = 0; index < table.size( ); index++ )
+    {
+        // Components of the edge neighbours, each one is flooded from its
+        // first pixel
+        size_t visited { };
+        int32_t components { };
+        int32_t count { };
+
+        for ( size_t start = 0; start < 8; start++ )
+        {
+            if ( ( index >> start & 1 ) == 0 )
+            {
+                continue;
+            }
+
+            count++;
+
+            if ( ( visited >> start & 1 ) != 0 )
+            {
+                continue;
+            }
+
+            components++;
+
+            size_t stack = size_t { 1 } << start;
+            visited |= stack;
+
+            while ( stack != 0 )
+            {
+                size_t current { };
+                while ( ( stack >> current & 1 ) == 0 )
+                {
+                    current++;
+                }
+                stack &= ~( size_t { 1 } << current );
+
+                const std::array< size_t, 4 > adjacent {
+                    ( current + 1 ) % 8,
+                    ( current + 7 ) % 8,
+                    current % 2 == 0 ? ( current + 2 ) % 8 : current,
+                    current % 2 == 0 ? ( current + 6 ) % 8 : current };
+
+                for ( const auto next : adjacent )
+                {
+                    const auto bit = size_t { 1 } << next;
+
+                    if ( ( index & bit ) != 0 && ( visited & bit ) == 0 )
+                    {
+                        visited |= bit;
+                        stack |= bit;
+                    }
+                }
+            }
+        }
+
+        // The 4 neighbours are the even bits
+        const auto border = ( index & 0b0101'0101 ) != 0b0101'0101;
+
+        table[ index ] = count >= 2 && components == 1 && border ? 1 : 0;
+    }
+
+    return table;
+}
+
+constexpr auto kRedundantTable = redundantTable( );
+
+// The offsets of the neighbours in the bit order of EdgeBitmap::neighbours
+constexpr std::array< int32_t, 8 > kNeighbourX { 0, 1, 1, 1, 0, -1, -1, -1 };
+constexpr std::array< int32_t, 8 > kNeighbourY { -1, -1, 0, 1, 1, 1, 0, -1 };
+
+// The pixels x - 1 of word w moved to the bits of the pixels x
+inline uint64_t leftNeighbours( const uint64_t* row, size_t w )
+{
+    return row[ w ] << 1 | ( w > 0 ? row[ w - 1 ] >> 63 : 0 );
+}
+
+// The pixels x + 1 of word w moved to the bits of the pixels x
+inline uint64_t rightNeighbours( const uint64_t* row, size_t w,
+                                 size_t wordsPerRow )
+{
+    return row[ w ] >> 1 | ( w + 1 < wordsPerRow ? row[ w + 1 ] << 63 : 0 );
+}
+
+/*
+ * Function that evaluates the Zhang-Suen deletion conditions of 64 pixels.
+ * The counts are replaced by "at least one" and "at least two" masks.
+ *
+ * @param [in]  center      The pixels P1
+ * @param [in]  p           The neighbours P2 to P9 of every pixel
+ * @param [in]  iteration   The sub iteration, 0 or 1
+ *
+ * @returns The pixels to delete
+ */
+uint64_t deletionMask( uint64_t center, const std::array< uint64_t, 8 >& p,
+                       int32_t iteration )
+{
+    // A(P1) == 1, transitions from 0 to 1 in the order P2 P3 ... P9 P2
+    uint64_t oneTransition { };
+    uint64_t twoTransitions { };
+
+    // 2 <= B(P1) <= 6, at least two edge and at least two background
+    // neighbours
+    uint64_t oneEdge { };
+    uint64_t twoEdges { };
+    uint64_t oneBackground { };
+    uint64_t twoBackgrounds { };
+
+    for ( size_t i = 0; i < p.size( ); i++ )
+    {
+        const auto transition = ~p[ i ] & p[ ( i + 1 ) % p.size( ) ];
+        twoTransitions |= oneTransition & transition;
+        oneTransition |= transition;
+
+        twoEdges |= oneEdge & p[ i ];
+        oneEdge |= p[ i ];
+
+        twoBackgrounds |= oneBackground & ~p[ i ];
+        oneBackground |= ~p[ i ];
+    }
+
+    // P2 = p[0], P4 = p[2], P6 = p[4], P8 = p[6]
+    const auto products =
+        iteration == 0
+            ? ~( p[ 0 ] & p[ 2 ] & p[ 4 ] ) & ~( p[ 2 ] & p[ 4 ] & p[ 6 ] )
+            : ~( p[ 0 ] & p[ 2 ] & p[ 6 ] ) & ~( p[ 0 ] & p[ 4 ] & p[ 6 ] );
+
+    return center & oneTransition & ~twoTransitions & twoEdges &
+           twoBackgrounds & products;
+}
+} // namespace
+
+EdgeBitmap::EdgeBitmap( std::pmr::memory_resource* resource )
+    : mWords( resource )
+    , mPreviousRow( resource )
+    , mDeletions( resource )
+{
+}
+
+EdgeBitmap::EdgeBitmap( const cv::Mat& image,
+                        std::pmr::memory_resource* resource )
+    : EdgeBitmap( resource )
+{
+    assign( image );
+}
+
+void EdgeBitmap::create( int32_t rows, int32_t cols )
+{
+    mRows = rows;
+    mCols = cols;
+    mWordsPerRow =
+        static_cast< size_t >( ( cols + kWordBits - 1 ) / kWordBits );
+    mWords.assign( static_cast< size_t >( rows + 2 ) * mWordsPerRow, 0 );
+}
+
+void EdgeBitmap::assign( const cv::Mat& image )
+{
+    CV_Assert( image.type( ) == CV_8UC1 );
+
+    create( image.rows, image.cols );
+
+    for ( int32_t y = 0; y < mRows; y++ )
+    {
+        const auto srcPtr = image.ptr< uint8_t >( y );
+        const auto dstPtr = row( y );
+
+        for ( size_t w = 0; w < mWordsPerRow; w++ )
+        {
+            const auto x0 = static_cast< int32_t >( w ) * kWordBits;
+            const auto bits = std::min( kWordBits, mCols - x0 );
+
+            uint64_t word { };
+            for ( int32_t i = 0; i < bits; i++ )
+            {
+                word |= static_cast< uint64_t >( srcPtr[ x0 + i ] != 0 ) << i;
+            }
+
+            dstPtr[ w ] = word;
+        }
+    }
+}
+
+void EdgeBitmap::copyTo( cv::Mat& image ) const
+{
+    image.create( mRows, mCols, CV_8UC1 );
+
+    for ( int32_t y = 0; y < mRows; y++ )
+    {
+        const auto srcPtr = row( y );
+        const auto dstPtr = image.ptr< uint8_t >( y );
+
+        std::fill( dstPtr, dstPtr + mCols, uint8_t { 0 } );
+
+        for ( size_t w = 0; w < mWordsPerRow; w++ )
+        {
+            const auto x0 = static_cast< int32_t >( w ) * kWordBits;
+
+            for ( auto word = srcPtr[ w ]; word != 0; word &= word - 1 )
+            {
+                dstPtr[ x0 + lowestBit( word ) ] = 255;
+            }
+        }
+    }
+}
+
+uint8_t EdgeBitmap::neighbours( int32_t x, int32_t y ) const
+{
+    const auto bit = [ & ]( int32_t dx, int32_t dy, int32_t index )
+    {
+        return static_cast< uint8_t >( test( x + dx, y + dy ) ? 1 << index
+                                                                : 0 );
+    };
+
+    return bit( 0, -1, 0 ) | bit( 1, -1, 1 ) | bit( 1, 0, 2 ) |
+           bit( 1, 1, 3 ) | bit( 0, 1, 4 ) | bit( -1, 1, 5 ) |
+           bit( -1, 0, 6 ) | bit( -1, -1, 7 );
+}
+
+void EdgeBitmap::edgePoints( std::pmr::vector< cv::Point2i >& points ) const
+{
+    points.clear( );
+
+    for ( int32_t y = 0; y < mRows; y++ )
+    {
+        const auto rowPtr = row( y );
+
+        for ( size_t w = 0; w < mWordsPerRow; w++ )
+        {
+            const auto x0 = static_cast< int32_t >( w ) * kWordBits;
+
+            for ( auto word = rowPtr[ w ]; word != 0; word &= word - 1 )
+            {
+                points.emplace_back( x0 + lowestBit( word ), y );
+            }
+        }
+    }
+}
+
+void EdgeBitmap::edgePoints( int32_t y, std::pmr::vector< int32_t >& xs ) const
+{
+    xs.clear( );
+
+    const auto rowPtr = row( y );
+
+    for ( size_t w = 0; w < mWordsPerRow; w++ )
+    {
+        const auto x0 = static_cast< int32_t >( w ) * kWordBits;
+
+        for ( auto word = rowPtr[ w ]; word != 0; word &= word - 1 )
+        {
+            xs.push_back( x0 + lowestBit( word ) );
+        }
+    }
+}
+
+size_t EdgeBitmap::thin( )
+{
+    const auto resource = mWords.get_allocator( ).resource( );
+    const auto numberRows = static_cast< size_t >( mRows ) + 2;
+
+    // The first iteration tests every row, afterwards only the rows next to
+    // a deletion can change their decision
+    std::array< std::pmr::vector< uint8_t >, 2 > testRows {
+        std::pmr::vector< uint8_t >( numberRows, 1, resource ),
+        std::pmr::vector< uint8_t >( numberRows, 1, resource ) };
+    std::pmr::vector< uint8_t > changedRows( numberRows, 0, resource );
+
+    mPreviousRow.resize( mWordsPerRow );
+    mDeletions.resize( mWordsPerRow );
+
+    size_t deletedPixels { };
+    size_t changedPixels;
+
+    do
+    {
+        changedPixels = 0;
+
+        for ( int32_t iteration = 0; iteration < 2; iteration++ )
+        {
+            std::fill(
+                changedRows.begin( ), changedRows.end( ), uint8_t { 0 } );
+
+            changedPixels += thinIteration(
+                iteration,
+                testRows[ static_cast< size_t >( iteration ) ],
+                changedRows );
+
+            for ( size_t y = 1; y + 1 < numberRows; y++ )
+            {
+                if ( changedRows[ y ] == 0 )
+                {
+                    continue;
+                }
+
+                for ( auto& flags : testRows )
+                {
+                    flags[ y - 1 ] = 1;
+                    flags[ y ] = 1;
+                    flags[ y + 1 ] = 1;
+                }
+            }
+        }
+
+        deletedPixels += changedPixels;
+
+    } while ( changedPixels > 0 );
+
+    return deletedPixels;
+}
+
+size_t EdgeBitmap::thinIteration( int32_t iteration,
+                                  std::pmr::vector< uint8_t >& testRows,
+                                  std::pmr::vector< uint8_t >& changedRows )
+{
+    size_t deletedPixels { };
+
+    // All rows are tested on the state before the sub iteration. The row
+    // above is saved before its deletions are applied.
+    bool previousChanged = false;
+
+    for ( int32_t y = 0; y < mRows; y++ )
+    {
+        const auto index = static_cast< size_t >( y + 1 );
+
+        if ( testRows[ index ] == 0 )
+        {
+            previousChanged = false;
+            continue;
+        }
+
+        testRows[ index ] = 0;
+
+        const auto topPtr =
+            previousChanged ? mPreviousRow.data( ) : row( y - 1 );
+        const auto centerPtr = row( y );
+        const auto downPtr = row( y + 1 );
+
+        uint64_t anyDeletion { };
+
+        for ( size_t w = 0; w < mWordsPerRow; w++ )
+        {
+            const auto center = centerPtr[ w ];
+
+            if ( center == 0 )
+            {
+                mDeletions[ w ] = 0;
+                continue;
+            }
+
+            // P2 to P9
+            const std::array< uint64_t, 8 > p {
+                topPtr[ w ],
+                rightNeighbours( topPtr, w, mWordsPerRow ),
+                rightNeighbours( centerPtr, w, mWordsPerRow ),
+                rightNeighbours( downPtr, w, mWordsPerRow ),
+                downPtr[ w ],
+                leftNeighbours( downPtr, w ),
+                leftNeighbours( centerPtr, w ),
+                leftNeighbours( topPtr, w ) };
+
+            mDeletions[ w ] = deletionMask( center, p, iteration );
+            anyDeletion |= mDeletions[ w ];
+        }
+
+        if ( anyDeletion == 0 )
+        {
+            previousChanged = false;
+            continue;
+        }
+
+        std::copy( centerPtr, centerPtr + mWordsPerRow, mPreviousRow.begin( ) );
+
+        for ( size_t w = 0; w < mWordsPerRow; w++ )
+        {
+            centerPtr[ w ] &= ~mDeletions[ w ];
+            deletedPixels +=
+                std::bitset< kWordBits >( mDeletions[ w ] ).count( );
+        }
+
+        changedRows[ index ] = 1;
+        previousChanged = true;
+    }
+
+    return deletedPixels;
+}
+
+size_t EdgeBitmap::removeRedundantPixels( )
+{
+    const auto resource = mWords.get_allocator( ).resource( );
+
+    // Neighbours of removed pixels that the scan has already passed
+    std::pmr::vector< cv::Point2i > stack( resource );
+
+    size_t removedPixels { };
+
+    const auto removeIfRedundant = [ & ]( int32_t x, int32_t y )
+    {
+        if ( ! test( x, y ) || kRedundantTable[ neighbours( x, y ) ] == 0 )
+        {
+            return;
+        }
+
+        reset( x, y );
+        removedPixels++;
+
+        for ( size_t i = 0; i < kNeighbourX.size( ); i++ )
+        {
+            const auto nx = x + kNeighbourX[ i ];
+            const auto ny = y + kNeighbourY[ i ];
+
+            if ( test( nx, ny ) )
+            {
+                stack.emplace_back( nx, ny );
+            }
+        }
+    };
+
+    for ( int32_t y = 0; y < mRows; y++ )
+    {
+        const auto rowPtr = row( y );
+
+        for ( size_t w = 0; w < mWordsPerRow; w++ )
+        {
+            const auto x0 = static_cast< int32_t >( w ) * kWordBits;
+
+            // The pixels of the word as they were before the scan reached it,
+            // removed ones are skipped by removeIfRedundant
+            for ( auto word = rowPtr[ w ]; word != 0; word &= word - 1 )
+            {
+                removeIfRedundant( x0 + lowestBit( word ), y );
+            }
+        }
+    }
+
+    while ( ! stack.empty( ) )
+    {
+        const auto point = stack.back( );
+        stack.pop_back( );
+
+        removeIfRedundant( point.x, point.y );
+    }
+
+    return removedPixels;
+}
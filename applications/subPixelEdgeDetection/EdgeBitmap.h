@@ -0,0 +1,145 @@
+#pragma once
+
+// Std includes
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// OpenCV includes
+#include <opencv2/core.hpp>
+
+/*
+ * Binary edge image with one bit per pixel. Pixel x of a row is bit x % 64 of
+ * word x / 64, the unused bits of the last word are always 0. A background
+ * row above and below the image keeps the row neighbours of every pixel
+ * inside the buffer.
+ *
+ * The binary stages read an eighth of the bytes of a CV_8UC1 image and skip
+ * 64 background pixels with one compare.
+ */
+class EdgeBitmap
+{
+public:
+    explicit EdgeBitmap( std::pmr::memory_resource* resource =
+                             std::pmr::get_default_resource( ) );
+
+    // Every nonzero pixel of image (CV_8UC1) is an edge
+    explicit EdgeBitmap( const cv::Mat& image,
+                         std::pmr::memory_resource* resource =
+                             std::pmr::get_default_resource( ) );
+
+    EdgeBitmap( const EdgeBitmap& ) = delete;
+    EdgeBitmap& operator=( const EdgeBitmap& ) = delete;
+    EdgeBitmap( EdgeBitmap&& ) = delete;
+    EdgeBitmap& operator=( EdgeBitmap&& ) = delete;
+    ~EdgeBitmap( ) = default;
+
+    // Resizes the bitmap, all pixels are background
+    void create( int32_t rows, int32_t cols );
+
+    // Every nonzero pixel of image (CV_8UC1) is an edge
+    void assign( const cv::Mat& image );
+
+    // Writes the edges as 255 and the background as 0 (CV_8UC1)
+    void copyTo( cv::Mat& image ) const;
+
+    int32_t rows( ) const { return mRows; }
+    int32_t cols( ) const { return mCols; }
+    size_t wordsPerRow( ) const { return mWordsPerRow; }
+
+    // The words of row y, y may be -1 and rows( ) for the background rows
+    const uint64_t* row( int32_t y ) const
+    {
+        return mWords.data( ) +
+               static_cast< size_t >( y + 1 ) * mWordsPerRow;
+    }
+
+    // True for an edge pixel, positions outside are background
+    bool test( int32_t x, int32_t y ) const
+    {
+        return x >= 0 && x < mCols && y >= 0 && y < mRows &&
+               ( ( row( y )[ static_cast< size_t >( x ) >> 6 ] >> ( x & 63 ) ) &
+                 1 ) != 0;
+    }
+
+    bool test( const cv::Point2i& p ) const { return test( p.x, p.y ); }
+
+    // Marks a pixel inside the bitmap as edge
+    void set( int32_t x, int32_t y )
+    {
+        row( y )[ static_cast< size_t >( x ) >> 6 ] |= uint64_t { 1 }
+                                                        << ( x & 63 );
+    }
+
+    // Marks a pixel inside the bitmap as background
+    void reset( int32_t x, int32_t y )
+    {
+        row( y )[ static_cast< size_t >( x ) >> 6 ] &=
+            ~( uint64_t { 1 } << ( x & 63 ) );
+    }
+
+    // The 8 neighbours of a pixel, P2 (top) is bit 0 and the others follow
+    // clockwise up to P9 (top left) as bit 7
+    //
+    // |P9|P2|P3|
+    // |P8|P1|P4|
+    // |P7|P6|P5|
+    uint8_t neighbours( int32_t x, int32_t y ) const;
+
+    // The edge pixels in scan order, background words are skipped
+    void edgePoints( std::pmr::vector< cv::Point2i >& points ) const;
+
+    // The edge pixels of row y in ascending order
+    void edgePoints( int32_t y, std::pmr::vector< int32_t >& xs ) const;
+
+    /*
+     * Zhang-Suen thinning, 64 pixels at once. The neighbours of a word are
+     * shifted words of the three rows, the deletion conditions are
+     * evaluated with bit operations. Rows whose neighbourhood did not change
+     * since their last test in a sub iteration are skipped.
+     *
+     * @returns The number of deleted pixels
+     */
+    size_t thin( );
+
+    /*
+     * Removes the edge pixels that are not needed for the 8 connectivity. A
+     * pixel is removed if it has at least two edge neighbours, they are 8
+     * connected without it and one of its 4 neighbours is background, so no
+     * line is split or gets a hole. Like in the Zhang-Suen thinning the end
+     * pixel of a line ending in a staircase step is removed, which shortens
+     * the line by one pixel. The pixels are tested in scan order and removed
+     * at once, the neighbours of a removed pixel are tested again.
+     *
+     * Afterwards no pixel satisfies the rule, so every edge is one pixel
+     * wide. Staircase corners are removed, which the thinning keeps.
+     *
+     * @returns The number of removed pixels
+     */
+    size_t removeRedundantPixels( );
+
+private:
+    uint64_t* row( int32_t y )
+    {
+        return mWords.data( ) +
+               static_cast< size_t >( y + 1 ) * mWordsPerRow;
+    }
+
+    // One sub iteration over the rows flagged in testRows, the rows with
+    // deletions are flagged in changedRows. Both are indexed by y + 1.
+    size_t thinIteration( int32_t iteration,
+                          std::pmr::vector< uint8_t >& testRows,
+                          std::pmr::vector< uint8_t >& changedRows );
+
+    int32_t mRows { };
+    int32_t mCols { };
+    size_t mWordsPerRow { };
+
+    // mRows + 2 rows of mWordsPerRow words
+    std::pmr::vector< uint64_t > mWords;
+
+    // Scratch rows of the thinning, the row above before the deletions of
+    // the current sub iteration and the deletions of the current row
+    std::pmr::vector< uint64_t > mPreviousRow;
+    std::pmr::vector< uint64_t > mDeletions;
+};
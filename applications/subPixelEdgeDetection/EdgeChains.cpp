@@ -0,0 +1,326 @@
+#include "EdgeChains.h"
+
+// Std includes
+#include <array>
+#include <cstdlib>
+
+namespace
+{
+// Pixel states, kVisited is set on top of the type
+constexpr uint8_t kBackground = 0;
+constexpr uint8_t kIsolated = 1;
+constexpr uint8_t kEndpoint = 2;
+constexpr uint8_t kRegular = 3;
+constexpr uint8_t kJunction = 4;
+constexpr uint8_t kTypeMask = 0x7f;
+constexpr uint8_t kVisited = 0x80;
+
+// The 4 neighbours come first, so a walk prefers straight steps to diagonal
+// steps and does not cut corners of a staircase.
+constexpr std::array< int32_t, 8 > kNeighbourX = { 1, 0, -1, 0, 1, -1, -1, 1 };
+constexpr std::array< int32_t, 8 > kNeighbourY = { 0, 1, 0, -1, 1, 1, -1, -1 };
+
+class ChainLinker
+{
+public:
+    ChainLinker( const cv::Mat& edges, EdgeChains& chains,
+                 std::pmr::memory_resource* resource );
+
+    ChainLinker( const ChainLinker& ) = delete;
+    ChainLinker& operator=( const ChainLinker& ) = delete;
+    ChainLinker( ChainLinker&& ) = delete;
+    ChainLinker& operator=( ChainLinker&& ) = delete;
+    ~ChainLinker( ) = default;
+
+    void run( );
+
+private:
+    uint8_t& state( const cv::Point2i& p )
+    {
+        return mStates.ptr< uint8_t >( p.y )[ p.x ];
+    }
+
+    int32_t& junctionId( const cv::Point2i& p )
+    {
+        return mJunctionIds.ptr< int32_t >( p.y )[ p.x ];
+    }
+
+    bool isJunction( const cv::Point2i& p )
+    {
+        return ( state( p ) & kTypeMask ) == kJunction;
+    }
+
+    bool isFree( const cv::Point2i& p )
+    {
+        const auto s = state( p );
+        return s != kBackground && ( s & kVisited ) == 0 &&
+               ( s & kTypeMask ) != kJunction;
+    }
+
+    void classifyPixels( );
+    void labelJunctions( );
+
+    // The next point of a walk: a free neighbour, else a junction neighbour
+    bool nextPoint( const cv::Point2i& current, int32_t startJunction,
+                    bool firstStep, cv::Point2i& next );
+
+    // Walks one chain from start over first, first may be start for a chain
+    // of one point
+    void walk( const cv::Point2i& start, const cv::Point2i& first );
+
+    EdgeChains& mChains;
+
+    // Pixel states with a background border of 1 pixel, so the neighbours of
+    // an edge pixel are always inside
+    cv::Mat mStates;
+
+    // The junction index of every junction pixel, same border
+    cv::Mat mJunctionIds;
+
+    // The pixels in scan order, in border coordinates
+    std::pmr::vector< cv::Point2i > mEndpoints;
+    std::pmr::vector< cv::Point2i > mJunctionPixels;
+    std::pmr::vector< cv::Point2i > mOtherPixels;
+};
+
+ChainLinker::ChainLinker( const cv::Mat& edges, EdgeChains& chains,
+                          std::pmr::memory_resource* resource )
+    : mChains( chains )
+    , mEndpoints( resource )
+    , mJunctionPixels( resource )
+    , mOtherPixels( resource )
+{
+    mStates.create( edges.rows + 2, edges.cols + 2, CV_8UC1 );
+    mStates.setTo( cv::Scalar::all( kBackground ) );
+
+    for ( int32_t y = 0; y < edges.rows; y++ )
+    {
+        const auto srcPtr = edges.ptr< uint8_t >( y );
+        const auto dstPtr = mStates.ptr< uint8_t >( y + 1 ) + 1;
+
+        for ( int32_t x = 0; x < edges.cols; x++ )
+        {
+            dstPtr[ x ] = srcPtr[ x ] != 0 ? kIsolated : kBackground;
+        }
+    }
+
+    mJunctionIds.create( mStates.size( ), CV_32SC1 );
+    mJunctionIds.setTo( cv::Scalar::all( kNoJunction ) );
+}
+
+void ChainLinker::classifyPixels( )
+{
+    for ( int32_t y = 1; y < mStates.rows - 1; y++ )
+    {
+        for ( int32_t x = 1; x < mStates.cols - 1; x++ )
+        {
+            const cv::Point2i p( x, y );
+
+            if ( state( p ) == kBackground )
+            {
+                continue;
+            }
+
+            int32_t neighbours = 0;
+            for ( size_t k = 0; k < kNeighbourX.size( ); k++ )
+            {
+                const cv::Point2i q( x + kNeighbourX[ k ],
+                                     y + kNeighbourY[ k ] );
+                neighbours += state( q ) != kBackground ? 1 : 0;
+            }
+
+            if ( neighbours == 1 )
+            {
+                state( p ) = kEndpoint;
+                mEndpoints.push_back( p );
+            }
+            else if ( neighbours >= 3 )
+            {
+                state( p ) = kJunction;
+                mJunctionPixels.push_back( p );
+            }
+            else
+            {
+                state( p ) = neighbours == 0 ? kIsolated : kRegular;
+                mOtherPixels.push_back( p );
+            }
+        }
+    }
+}
+
+void ChainLinker::labelJunctions( )
+{
+    std::pmr::vector< cv::Point2i > stack( mEndpoints.get_allocator( ) );
+
+    for ( const auto& pixel : mJunctionPixels )
+    {
+        if ( junctionId( pixel ) != kNoJunction )
+        {
+            continue;
+        }
+
+        const auto id = static_cast< int32_t >( mChains.junctions.size( ) );
+        mChains.junctions.push_back( pixel - cv::Point2i( 1, 1 ) );
+
+        junctionId( pixel ) = id;
+        stack.push_back( pixel );
+
+        while ( ! stack.empty( ) )
+        {
+            const auto p = stack.back( );
+            stack.pop_back( );
+
+            for ( size_t k = 0; k < kNeighbourX.size( ); k++ )
+            {
+                const cv::Point2i q( p.x + kNeighbourX[ k ],
+                                     p.y + kNeighbourY[ k ] );
+
+                if ( isJunction( q ) && junctionId( q ) == kNoJunction )
+                {
+                    junctionId( q ) = id;
+                    stack.push_back( q );
+                }
+            }
+        }
+    }
+}
+
+bool ChainLinker::nextPoint( const cv::Point2i& current, int32_t startJunction,
+                             bool firstStep, cv::Point2i& next )
+{
+    bool foundJunction = false;
+
+    for ( size_t k = 0; k < kNeighbourX.size( ); k++ )
+    {
+        const cv::Point2i q( current.x + kNeighbourX[ k ],
+                             current.y + kNeighbourY[ k ] );
+
+        if ( isFree( q ) )
+        {
+            next = q;
+            return true;
+        }
+
+        // Do not step back into the junction the chain just left
+        if ( ! foundJunction && isJunction( q ) &&
+             ! ( firstStep && junctionId( q ) == startJunction ) )
+        {
+            next = q;
+            foundJunction = true;
+        }
+    }
+
+    return foundJunction;
+}
+
+void ChainLinker::walk( const cv::Point2i& start, const cv::Point2i& first )
+{
+    const cv::Point2i border( 1, 1 );
+    const auto chainBegin = mChains.points.size( );
+
+    const auto startJunction = junctionId( start );
+    auto endJunction = kNoJunction;
+
+    mChains.points.push_back( start - border );
+    if ( startJunction == kNoJunction )
+    {
+        state( start ) |= kVisited;
+    }
+
+    auto current = first;
+    auto firstStep = true;
+
+    while ( current != start )
+    {
+        mChains.points.push_back( current - border );
+
+        if ( isJunction( current ) )
+        {
+            endJunction = junctionId( current );
+            break;
+        }
+
+        state( current ) |= kVisited;
+
+        cv::Point2i next;
+        if ( ! nextPoint( current, startJunction, firstStep, next ) )
+        {
+            break;
+        }
+
+        current = next;
+        firstStep = false;
+    }
+
+    // A chain without ends that returns next to its start is a closed loop
+    const auto numberPoints = mChains.points.size( ) - chainBegin;
+    const auto delta = mChains.points.back( ) - mChains.points[ chainBegin ];
+    const auto closed = startJunction == kNoJunction &&
+                        endJunction == kNoJunction && numberPoints > 2 &&
+                        ( state( start ) & kTypeMask ) == kRegular &&
+                        std::abs( delta.x ) <= 1 && std::abs( delta.y ) <= 1;
+
+    mChains.offsets.push_back( mChains.points.size( ) );
+    mChains.startJunctions.push_back( startJunction );
+    mChains.endJunctions.push_back( endJunction );
+    mChains.closed.push_back( closed ? 1 : 0 );
+}
+
+void ChainLinker::run( )
+{
+    classifyPixels( );
+    labelJunctions( );
+
+    // Open chains from their endpoints
+    for ( const auto& pixel : mEndpoints )
+    {
+        if ( ( state( pixel ) & kVisited ) != 0 )
+        {
+            continue;
+        }
+
+        cv::Point2i first;
+        walk( pixel, nextPoint( pixel, kNoJunction, false, first ) ? first
+                                                                     : pixel );
+    }
+
+    // Branches between junctions and the ones left at the junctions
+    for ( const auto& pixel : mJunctionPixels )
+    {
+        for ( size_t k = 0; k < kNeighbourX.size( ); k++ )
+        {
+            const cv::Point2i q( pixel.x + kNeighbourX[ k ],
+                                 pixel.y + kNeighbourY[ k ] );
+
+            if ( isFree( q ) )
+            {
+                walk( pixel, q );
+            }
+        }
+    }
+
+    // Closed loops and isolated pixels
+    for ( const auto& pixel : mOtherPixels )
+    {
+        if ( ( state( pixel ) & kVisited ) != 0 )
+        {
+            continue;
+        }
+
+        cv::Point2i first;
+        walk( pixel, nextPoint( pixel, kNoJunction, false, first ) ? first
+                                                                     : pixel );
+    }
+}
+} // namespace
+
+void linkEdgeChains( const cv::Mat& edges, EdgeChains& chains,
+                     std::pmr::memory_resource* resource )
+{
+    CV_Assert( edges.type( ) == CV_8UC1 );
+
+    chains.clear( );
+
+    ChainLinker linker( edges, chains, resource );
+    linker.run( );
+}
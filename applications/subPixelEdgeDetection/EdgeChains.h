@@ -0,0 +1,64 @@
+#pragma once
+
+// Std includes
+#include <memory_resource>
+#include <vector>
+
+// OpenCV includes
+#include <opencv2/core.hpp>
+
+// Junction index of chain ends that are not at a junction
+constexpr int32_t kNoJunction = -1;
+
+/*
+ * Ordered edge chains of an edge image together with their junction topology.
+ * The points of chain i are [offsets[i], offsets[i + 1]) in points.
+ */
+struct EdgeChains
+{
+    std::vector< cv::Point2i > points;
+    std::vector< size_t > offsets { 0 };
+
+    // The junction the chain starts and ends at, kNoJunction for endpoints
+    std::vector< int32_t > startJunctions;
+    std::vector< int32_t > endJunctions;
+
+    // Set for chains that are closed loops, the first point is not repeated
+    std::vector< uint8_t > closed;
+
+    // One entry per junction. A junction is a cluster of connected junction
+    // pixels, represented by its first pixel in scan order.
+    std::vector< cv::Point2i > junctions;
+
+    // The number of chains
+    size_t size( ) const { return offsets.size( ) - 1; }
+
+    // Removes all chains and junctions, the capacity is kept
+    void clear( )
+    {
+        points.clear( );
+        offsets.assign( 1, 0 );
+        startJunctions.clear( );
+        endJunctions.clear( );
+        closed.clear( );
+        junctions.clear( );
+    }
+};
+
+/*
+ * Function that decomposes a thin edge image into ordered chains. Every edge
+ * pixel is classified by the number of its 8 neighbours as endpoint (1),
+ * regular (2) or junction (3 and more). Chains are walked from the endpoints,
+ * then from the junctions, the remaining pixels form closed loops. Every
+ * branch is walked once, so the cost is linear in the number of edge pixels.
+ *
+ * Regular and endpoint pixels belong to exactly one chain. Junction pixels are
+ * shared as first or last point by the chains meeting there.
+ *
+ * @param [in]  edges     The thin edge image (CV_8UC1), nonzero is edge
+ * @param [out] chains    The chains, cleared first
+ * @param [in]  resource  The memory resource of the scratch buffers
+ */
+void linkEdgeChains(
+    const cv::Mat& edges, EdgeChains& chains,
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource( ) );
@@ -0,0 +1,126 @@
+#include "FacetPlanes.h"
+#include "ThreadPool.h"
+
+// Std includes
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+// Number of rows per work item.
+constexpr int32_t kRowStripe = 16;
+
+constexpr float kQuarter = 1.0f / 4.0f;
+constexpr float kSixth = 1.0f / 6.0f;
+constexpr float kNinth = 1.0f / 9.0f;
+constexpr float kTwoThirds = 2.0f / 3.0f;
+
+void computeFacetRows( const cv::Mat& image,
+                       const std::vector< uint8_t >& edgeRows,
+                       FacetPlanes& planes, int32_t y0, int32_t y1 )
+{
+    const auto cols = static_cast< size_t >( image.cols );
+
+    // Vertical pass of three rows, one replicated column on both sides
+    std::vector< float > sums( cols + 2 );
+    std::vector< float > differences( cols + 2 );
+    std::vector< float > curvatures( cols + 2 );
+
+    for ( int32_t y = y0; y < y1; y++ )
+    {
+        if ( ! edgeRows.empty( ) &&
+             edgeRows[ static_cast< size_t >( y ) ] == 0 )
+        {
+            continue;
+        }
+
+        const auto topPtr = image.ptr< float >( std::max( y - 1, 0 ) );
+        const auto centerPtr = image.ptr< float >( y );
+        const auto downPtr =
+            image.ptr< float >( std::min( y + 1, image.rows - 1 ) );
+
+        for ( size_t x = 0; x < cols; x++ )
+        {
+            sums[ x + 1 ] = topPtr[ x ] + centerPtr[ x ] + downPtr[ x ];
+            differences[ x + 1 ] = downPtr[ x ] - topPtr[ x ];
+            curvatures[ x + 1 ] =
+                topPtr[ x ] - 2.0f * centerPtr[ x ] + downPtr[ x ];
+        }
+
+        sums[ 0 ] = sums[ 1 ];
+        sums[ cols + 1 ] = sums[ cols ];
+        differences[ 0 ] = differences[ 1 ];
+        differences[ cols + 1 ] = differences[ cols ];
+        curvatures[ 0 ] = curvatures[ 1 ];
+        curvatures[ cols + 1 ] = curvatures[ cols ];
+
+        const auto k0Ptr = planes.coefficients[ 0 ].ptr< float >( y );
+        const auto k1Ptr = planes.coefficients[ 1 ].ptr< float >( y );
+        const auto k2Ptr = planes.coefficients[ 2 ].ptr< float >( y );
+        const auto k3Ptr = planes.coefficients[ 3 ].ptr< float >( y );
+        const auto k4Ptr = planes.coefficients[ 4 ].ptr< float >( y );
+        const auto k5Ptr = planes.coefficients[ 5 ].ptr< float >( y );
+
+        const auto s = sums.data( );
+        const auto d = differences.data( );
+        const auto c = curvatures.data( );
+
+        // Horizontal pass, column x of the image is x + 1 in the buffers
+        for ( size_t x = 0; x < cols; x++ )
+        {
+            const auto k3 =
+                ( s[ x ] - 2.0f * s[ x + 1 ] + s[ x + 2 ] ) * kSixth;
+            const auto k5 = ( c[ x ] + c[ x + 1 ] + c[ x + 2 ] ) * kSixth;
+
+            k1Ptr[ x ] = ( s[ x + 2 ] - s[ x ] ) * kSixth;
+            k2Ptr[ x ] = ( d[ x ] + d[ x + 1 ] + d[ x + 2 ] ) * kSixth;
+            k3Ptr[ x ] = k3;
+            k4Ptr[ x ] = ( d[ x + 2 ] - d[ x ] ) * kQuarter;
+            k5Ptr[ x ] = k5;
+
+            // The least squares constant is the mean corrected by the
+            // quadratic terms
+            k0Ptr[ x ] = ( s[ x ] + s[ x + 1 ] + s[ x + 2 ] ) * kNinth -
+                         kTwoThirds * ( k3 + k5 );
+        }
+    }
+}
+} // namespace
+
+void computeFacetPlanes( const cv::Mat& image, const cv::Mat& edges,
+                         FacetPlanes& planes, ThreadPool* threadPool )
+{
+    CV_Assert( image.type( ) == CV_32FC1 );
+    CV_Assert( edges.empty( ) ||
+               ( edges.type( ) == CV_8UC1 && edges.size( ) == image.size( ) ) );
+
+    for ( auto& plane : planes.coefficients )
+    {
+        plane.create( image.size( ), CV_32FC1 );
+    }
+
+    // Rows containing an edge pixel, empty for all rows
+    std::vector< uint8_t > edgeRows;
+    if ( ! edges.empty( ) )
+    {
+        edgeRows.resize( static_cast< size_t >( edges.rows ) );
+
+        for ( int32_t y = 0; y < edges.rows; y++ )
+        {
+            const auto rowPtr = edges.ptr< uint8_t >( y );
+            edgeRows[ static_cast< size_t >( y ) ] =
+                std::any_of( rowPtr,
+                             rowPtr + edges.cols,
+                             []( uint8_t value ) { return value != 0; } )
+                    ? 1
+                    : 0;
+        }
+    }
+
+    parallelFor( threadPool,
+                 0,
+                 image.rows,
+                 kRowStripe,
+                 [ & ]( int32_t y0, int32_t y1 )
+                 { computeFacetRows( image, edgeRows, planes, y0, y1 ); } );
+}
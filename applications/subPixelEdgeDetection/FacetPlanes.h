@@ -0,0 +1,42 @@
+#pragma once
+
+// Std includes
+#include <array>
+
+// OpenCV includes
+#include <opencv2/core.hpp>
+
+class ThreadPool;
+
+/*
+ * The second facet model of every pixel. The model is the least squares fit
+ * of
+ *
+ * f(x, y) = k0 + k1 * x + k2 * y + k3 * x^2 + k4 * x * y + k5 * y^2
+ *
+ * to the 3x3 neighbourhood, with x to the right and y down. Plane i holds
+ * k_i (CV_32FC1).
+ */
+struct FacetPlanes
+{
+    std::array< cv::Mat, 6 > coefficients;
+};
+
+/*
+ * Function that calculates the facet coefficients of a whole plane at once.
+ * Every coefficient is a separable 3x3 mask, so a vertical pass builds the
+ * sum, the difference and the second difference of three rows and a
+ * horizontal pass combines them. Both passes are branch free loops over a
+ * row. The borders are extended with the border pixel.
+ *
+ * If edges is given, only the rows containing an edge pixel are calculated,
+ * the other rows of the planes are undefined.
+ *
+ * @param [in]  image       The image to fit (CV_32FC1)
+ * @param [in]  edges       Optional edge image (CV_8UC1), nonzero is edge
+ * @param [out] planes      The coefficient planes
+ * @param [in]  threadPool  Optional thread pool
+ */
+void computeFacetPlanes( const cv::Mat& image, const cv::Mat& edges,
+                         FacetPlanes& planes,
+                         ThreadPool* threadPool = nullptr );
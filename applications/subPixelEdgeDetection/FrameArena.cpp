@@ -0,0 +1,51 @@
+#include "FrameArena.h"
+
+void* FrameArena::OverflowResource::do_allocate( size_t bytes,
+                                                 size_t alignment )
+{
+    mAllocated += bytes;
+    return std::pmr::new_delete_resource( )->allocate( bytes, alignment );
+}
+
+void FrameArena::OverflowResource::do_deallocate( void* p, size_t bytes,
+                                                  size_t alignment )
+{
+    std::pmr::new_delete_resource( )->deallocate( p, bytes, alignment );
+}
+
+bool FrameArena::OverflowResource::do_is_equal(
+    const std::pmr::memory_resource& other ) const noexcept
+{
+    return this == &other;
+}
+
+FrameArena::FrameArena( size_t initialSize )
+    : mBuffer( initialSize )
+{
+    mResource.emplace( mBuffer.data( ), mBuffer.size( ), &mOverflow );
+}
+
+std::pmr::memory_resource* FrameArena::resource( )
+{
+    return &*mResource;
+}
+
+void FrameArena::reset( )
+{
+    // Returns the overflow blocks to the global allocator
+    mResource->release( );
+
+    // Grow the buffer so the next frame fits without overflow
+    if ( mOverflow.mAllocated > 0 )
+    {
+        mBuffer.assign( mBuffer.size( ) + mOverflow.mAllocated, std::byte { } );
+        mOverflow.mAllocated = 0;
+    }
+
+    mResource.emplace( mBuffer.data( ), mBuffer.size( ), &mOverflow );
+}
+
+size_t FrameArena::capacity( ) const
+{
+    return mBuffer.size( );
+}
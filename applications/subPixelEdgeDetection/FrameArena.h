@@ -0,0 +1,57 @@
+#pragma once
+
+// Std includes
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+/*
+ * Monotonic arena for the scratch memory of one frame. Allocations only bump
+ * a pointer and deallocations are ignored, everything is released at once by
+ * reset. If a frame needs more than the buffer, the arena grows on reset, so
+ * after a few frames all scratch memory comes from one block and the global
+ * allocator is not touched anymore.
+ *
+ * The arena is not thread safe, use one arena per detector.
+ */
+class FrameArena
+{
+public:
+    explicit FrameArena( size_t initialSize = 1 << 20 );
+
+    FrameArena( const FrameArena& ) = delete;
+    FrameArena& operator=( const FrameArena& ) = delete;
+    FrameArena( FrameArena&& ) = delete;
+    FrameArena& operator=( FrameArena&& ) = delete;
+    ~FrameArena( ) = default;
+
+    // The memory resource to allocate from
+    std::pmr::memory_resource* resource( );
+
+    // Releases all allocations, memory taken from the arena must not be used
+    // anymore
+    void reset( );
+
+    // The size of the buffer
+    size_t capacity( ) const;
+
+private:
+    // Upstream of the monotonic resource that counts the bytes requested
+    // beyond the buffer
+    class OverflowResource : public std::pmr::memory_resource
+    {
+    public:
+        size_t mAllocated { };
+
+    private:
+        void* do_allocate( size_t bytes, size_t alignment ) override;
+        void do_deallocate( void* p, size_t bytes, size_t alignment ) override;
+        bool do_is_equal(
+            const std::pmr::memory_resource& other ) const noexcept override;
+    };
+
+    OverflowResource mOverflow;
+    std::vector< std::byte > mBuffer;
+    std::optional< std::pmr::monotonic_buffer_resource > mResource;
+};
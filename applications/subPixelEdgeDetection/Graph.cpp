@@ -1,29 +1,110 @@
 #include "Graph.h"
 
 // Std includes
+#include <algorithm>
 #include <queue>
 
 using intPair = std::pair< int32_t, int32_t >;
 
-Graph::Graph( int32_t numberVertices )
-    : mNumberVertices( numberVertices )
+namespace
+{
+// Up to this weight the shortest paths use Dial's bucket queue. The contour
+// graphs only have the weights 1 and 2.
+constexpr int32_t kMaxBucketWeight = 8;
+} // namespace
+
+Graph::Graph( int32_t numberVertices, std::pmr::memory_resource* resource )
+    : mResource( resource )
+    , mNumberVertices( numberVertices )
+    , mEdges( resource )
+    , mAdjacencyOffsets( resource )
+    , mNeighbours( resource )
+    , mWeights( resource )
+    , mBuckets( resource )
+    , mShortestPaths( resource )
+    , mParent( resource )
 {
-    mAdjacencyMatrix.resize( static_cast< size_t >( numberVertices ) );
     mShortestPaths.resize( static_cast< size_t >( numberVertices ) );
     // Create a parent vector to back track the shortest path
     mParent.resize( static_cast< size_t >( numberVertices ) );
 }
 
+void Graph::reserveEdges( size_t numberEdges )
+{
+    mEdges.reserve( numberEdges );
+}
+
 void Graph::addEdge( int32_t u, int32_t v, int32_t weight )
 {
-    mAdjacencyMatrix[ static_cast< size_t >( u ) ].emplace_back( v, weight );
+    mMinWeight = std::min( mMinWeight, weight );
+    mMaxWeight = std::max( mMaxWeight, weight );
+
+    mEdges.push_back( { u, v, weight } );
+    mAdjacencyOutdated = true;
+}
+
+void Graph::buildAdjacency( )
+{
+    const auto numberVertices = static_cast< size_t >( mNumberVertices );
+
+    // Count the degrees, every edge is stored in both directions
+    mAdjacencyOffsets.assign( numberVertices + 1, 0 );
+    for ( const auto& edge : mEdges )
+    {
+        mAdjacencyOffsets[ static_cast< size_t >( edge.u ) + 1 ]++;
+        mAdjacencyOffsets[ static_cast< size_t >( edge.v ) + 1 ]++;
+    }
+
+    for ( size_t u = 0; u < numberVertices; u++ )
+    {
+        mAdjacencyOffsets[ u + 1 ] += mAdjacencyOffsets[ u ];
+    }
+
+    // Stable counting sort, the neighbours keep the order of addEdge
+    mNeighbours.resize( 2 * mEdges.size( ) );
+    mWeights.resize( 2 * mEdges.size( ) );
+
+    std::pmr::vector< int32_t > positions(
+        mAdjacencyOffsets.begin( ), mAdjacencyOffsets.end( ) - 1, mResource );
+
+    const auto append = [ & ]( int32_t u, int32_t v, int32_t weight )
+    {
+        const auto position =
+            static_cast< size_t >( positions[ static_cast< size_t >( u ) ]++ );
+        mNeighbours[ position ] = v;
+        mWeights[ position ] = weight;
+    };
+
+    for ( const auto& edge : mEdges )
+    {
+        append( edge.u, edge.v, edge.weight );
+        append( edge.v, edge.u, edge.weight );
+    }
 
-    mAdjacencyMatrix[ static_cast< size_t >( v ) ].emplace_back( u, weight );
+    mAdjacencyOutdated = false;
 }
 
 void Graph::shortestPath( int32_t source )
 {
-    shortestPathDijkstra( source );
+    if ( mAdjacencyOutdated )
+    {
+        buildAdjacency( );
+    }
+
+    // The cached paths belong to the previous source
+    for ( auto& path : mShortestPaths )
+    {
+        path.clear( );
+    }
+
+    if ( mMinWeight >= 1 && mMaxWeight <= kMaxBucketWeight )
+    {
+        shortestPathDial( source );
+    }
+    else
+    {
+        shortestPathDijkstra( source );
+    }
 }
 
 void Graph::shortestPathDijkstra( int32_t source )
@@ -34,13 +115,16 @@ void Graph::shortestPathDijkstra( int32_t source )
     // are being preprocessed. This is weird syntax in C++.
     // Refer below link for details of this syntax
     // https://www.geeksforgeeks.org/implement-min-heap-using-stl/
-    std::priority_queue< intPair, std::vector< intPair >, std::greater<> >
-        pqpriorityQueue;
+    std::priority_queue< intPair, std::pmr::vector< intPair >, std::greater<> >
+        pqpriorityQueue( std::greater<> { },
+                         std::pmr::vector< intPair >( mResource ) );
 
     // Create a vector for distances and initialize all
     // distances as infinite (INF)
-    std::vector< int32_t > distances( static_cast< size_t >( mNumberVertices ),
-                                      std::numeric_limits< int32_t >::max( ) );
+    std::pmr::vector< int32_t > distances(
+        static_cast< size_t >( mNumberVertices ),
+        std::numeric_limits< int32_t >::max( ),
+        mResource );
 
     std::fill( mParent.begin( ), mParent.end( ), -1 );
 
@@ -64,15 +148,17 @@ void Graph::shortestPathDijkstra( int32_t source )
 
         // 'i' is used to get all adjacent vertices of a
         // vertex
-        std::vector< intPair >::iterator i;
-        for ( i = mAdjacencyMatrix[ static_cast< size_t >( u ) ].begin( );
-              i != mAdjacencyMatrix[ static_cast< size_t >( u ) ].end( );
+        const auto end = static_cast< size_t >(
+            mAdjacencyOffsets[ static_cast< size_t >( u ) + 1 ] );
+        for ( auto i = static_cast< size_t >(
+                  mAdjacencyOffsets[ static_cast< size_t >( u ) ] );
+              i < end;
               ++i )
         {
             // Get vertex label and weight of current
             // adjacent of u.
-            int32_t v = i->first;
-            const int32_t weight = i->second;
+            const int32_t v = mNeighbours[ i ];
+            const int32_t weight = mWeights[ i ];
 
             // If there is shorted path to v through u.
             if ( distances[ static_cast< size_t >( v ) ] >
@@ -90,30 +176,167 @@ void Graph::shortestPathDijkstra( int32_t source )
     }
 }
 
-void Graph::getShortestMaxPathRecursive( size_t destination,
-                                         std::vector< size_t >& shortestPath )
+/*
+ * Dial's algorithm: the vertices are kept in one bucket per distance instead
+ * of a heap. The weights are at most kMaxBucketWeight, so only the next
+ * kMaxBucketWeight + 1 distances can be pending and the buckets are reused
+ * cyclically. Each bucket is sorted by vertex before it is processed. Since
+ * all weights are positive, a bucket is complete when it is reached, so the
+ * vertices are processed in the same order as by the heap and the parents are
+ * the same as the ones of shortestPathDijkstra.
+ */
+void Graph::shortestPathDial( int32_t source )
 {
-    if ( mParent[ destination ] == -1 )
+    mSource = static_cast< size_t >( source );
+
+    const auto numberBuckets = static_cast< size_t >( mMaxWeight ) + 1;
+    mBuckets.resize( numberBuckets );
+    for ( auto& bucket : mBuckets )
     {
-        return;
+        bucket.clear( );
     }
 
-    getShortestMaxPathRecursive(
-        static_cast< size_t >( mParent[ destination ] ), shortestPath );
+    std::pmr::vector< int32_t > distances(
+        static_cast< size_t >( mNumberVertices ),
+        std::numeric_limits< int32_t >::max( ),
+        mResource );
+
+    std::fill( mParent.begin( ), mParent.end( ), -1 );
+
+    mBuckets[ 0 ].push_back( source );
+    distances[ static_cast< size_t >( source ) ] = 0;
+    size_t pending = 1;
+
+    for ( int32_t distance = 0; pending > 0; distance++ )
+    {
+        auto& bucket =
+            mBuckets[ static_cast< size_t >( distance ) % numberBuckets ];
+
+        if ( bucket.empty( ) )
+        {
+            continue;
+        }
 
-    shortestPath.push_back( destination );
+        std::sort( bucket.begin( ), bucket.end( ) );
+
+        // No edge has weight 0, so the relaxation never adds to this bucket
+        for ( const auto u : bucket )
+        {
+            // Skip the vertices that were reached with a shorter distance
+            if ( distances[ static_cast< size_t >( u ) ] != distance )
+            {
+                continue;
+            }
+
+            const auto end = static_cast< size_t >(
+                mAdjacencyOffsets[ static_cast< size_t >( u ) + 1 ] );
+            for ( auto i = static_cast< size_t >(
+                      mAdjacencyOffsets[ static_cast< size_t >( u ) ] );
+                  i < end;
+                  ++i )
+            {
+                const auto v = mNeighbours[ i ];
+                const auto weight = mWeights[ i ];
+
+                if ( distances[ static_cast< size_t >( v ) ] >
+                     distance + weight )
+                {
+                    distances[ static_cast< size_t >( v ) ] =
+                        distance + weight;
+                    mBuckets[ static_cast< size_t >( distance + weight ) %
+                              numberBuckets ]
+                        .push_back( v );
+                    pending++;
+
+                    mParent[ static_cast< size_t >( v ) ] = u;
+                }
+            }
+        }
+
+        pending -= bucket.size( );
+        bucket.clear( );
+    }
+}
+
+void Graph::appendShortestPath(
+    size_t destination, std::pmr::vector< size_t >& shortestPath ) const
+{
+    // Back track the parents and reverse the result, a recursion would need
+    // one stack frame per path point
+    const auto begin = shortestPath.size( );
+
+    for ( auto vertex = destination; mParent[ vertex ] != -1;
+          vertex = static_cast< size_t >( mParent[ vertex ] ) )
+    {
+        shortestPath.push_back( vertex );
+    }
+
+    shortestPath.push_back( mSource );
+
+    std::reverse( shortestPath.begin( ) +
+                      static_cast< std::ptrdiff_t >( begin ),
+                  shortestPath.end( ) );
 }
 
-const std::vector< size_t >& Graph::getShortestPath( size_t destination )
+const std::pmr::vector< size_t >&
+Graph::getShortestPath( size_t destination )
 {
     if ( ! mShortestPaths[ destination ].empty( ) )
     {
         return mShortestPaths[ destination ];
     }
 
-    mShortestPaths[ destination ].push_back( mSource );
-
-    getShortestMaxPathRecursive( destination, mShortestPaths[ destination ] );
+    appendShortestPath( destination, mShortestPaths[ destination ] );
 
     return mShortestPaths[ destination ];
 }
+
+void Graph::appendTreePath( size_t from, size_t to,
+                            std::pmr::vector< size_t >& path ) const
+{
+    const auto parent = [ & ]( size_t vertex )
+    { return static_cast< size_t >( mParent[ vertex ] ); };
+
+    const auto depth = [ & ]( size_t vertex )
+    {
+        size_t steps = 0;
+        for ( ; mParent[ vertex ] != -1; vertex = parent( vertex ) )
+        {
+            steps++;
+        }
+
+        return steps;
+    };
+
+    auto depthFrom = depth( from );
+    auto depthTo = depth( to );
+
+    // The part below the common ancestor on the side of to, reversed
+    std::pmr::vector< size_t > descent( mResource );
+
+    while ( depthFrom > depthTo )
+    {
+        path.push_back( from );
+        from = parent( from );
+        depthFrom--;
+    }
+
+    while ( depthTo > depthFrom )
+    {
+        descent.push_back( to );
+        to = parent( to );
+        depthTo--;
+    }
+
+    while ( from != to )
+    {
+        path.push_back( from );
+        from = parent( from );
+
+        descent.push_back( to );
+        to = parent( to );
+    }
+
+    path.push_back( from );
+    path.insert( path.end( ), descent.rbegin( ), descent.rend( ) );
+}
@@ -1,44 +1,91 @@
 #pragma once
 
 // Std includes
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
 #include <vector>
 
 class Graph
 {
 public:
-    Graph( int32_t numberVertices );
+    // All memory of the graph is taken from the given resource
+    explicit Graph( int32_t numberVertices,
+                    std::pmr::memory_resource* resource =
+                        std::pmr::get_default_resource( ) );
 
     Graph( ) = delete;
     Graph( const Graph& ) = delete;
     Graph& operator=( const Graph& ) = delete;
     Graph( Graph&& ) = delete;
     Graph& operator=( Graph&& ) = delete;
-    virtual ~Graph( ) = default;
+    ~Graph( ) = default;
+
+    // Reserves the memory for the given number of edges
+    void reserveEdges( size_t numberEdges );
 
     void addEdge( int32_t u, int32_t v, int32_t weight );
     void shortestPath( int32_t source );
 
-    const std::vector< size_t >& getShortestPath( size_t destination );
+    const std::pmr::vector< size_t >& getShortestPath( size_t destination );
+
+    // Appends the path between two vertices in the shortest path tree of the
+    // last source. It runs from the first vertex up to the deepest common
+    // ancestor and down to the second one, in a tree it is the shortest path.
+    void appendTreePath( size_t from, size_t to,
+                         std::pmr::vector< size_t >& path ) const;
 
 private:
     void shortestPathDijkstra( int32_t source );
 
-    void getShortestMaxPathRecursive( size_t destination,
-                                      std::vector< size_t >& shortestPath );
+    // Dial's algorithm, requires all weights in [1, kMaxBucketWeight]
+    void shortestPathDial( int32_t source );
+
+    // Builds the compressed sparse rows from the edge list
+    void buildAdjacency( );
+
+    // Appends the path from the source to the destination
+    void appendShortestPath( size_t destination,
+                             std::pmr::vector< size_t >& shortestPath ) const;
+
+    std::pmr::memory_resource* mResource { };
 
     int32_t mNumberVertices { };
 
-    // In a weighted graph, we need to store vertex
-    // and weight pair for every edge
-    std::vector< std::vector< std::pair< int32_t, int32_t > > >
-        mAdjacencyMatrix;
+    struct Edge
+    {
+        int32_t u;
+        int32_t v;
+        int32_t weight;
+    };
+
+    // The edges in the order they were added
+    std::pmr::vector< Edge > mEdges;
+
+    // The adjacency in compressed sparse rows. The neighbours of vertex u are
+    // [mAdjacencyOffsets[u], mAdjacencyOffsets[u + 1]) in mNeighbours and
+    // mWeights, in the order the edges were added.
+    std::pmr::vector< int32_t > mAdjacencyOffsets;
+    std::pmr::vector< int32_t > mNeighbours;
+    std::pmr::vector< int32_t > mWeights;
+
+    // Set if edges were added after the adjacency was built
+    bool mAdjacencyOutdated { true };
+
+    // The range of the edge weights, selects the shortest path algorithm
+    int32_t mMinWeight { std::numeric_limits< int32_t >::max( ) };
+    int32_t mMaxWeight { };
+
+    // The distance buckets of Dial's algorithm, kept to reuse the memory
+    std::pmr::vector< std::pmr::vector< int32_t > > mBuckets;
 
     // A vector collecting all calculated shortest path configurations
-    std::vector< std::vector< size_t > > mShortestPaths;
+    std::pmr::vector< std::pmr::vector< size_t > > mShortestPaths;
 
     // A vector keeping information about it parent to back track the shortest
     // path
-    std::vector< int32_t > mParent;
+    std::pmr::vector< int32_t > mParent;
 
     // The current source
     size_t mSource { };
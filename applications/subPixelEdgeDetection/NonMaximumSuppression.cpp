@@ -0,0 +1,737 @@
+#include "NonMaximumSuppression.h"
+#include "EdgeBitmap.h"
+#include "ThreadPool.h"
+
+// Std includes
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// OpenCV includes
+#include <opencv2/imgproc.hpp>
+
+namespace
+{
+// Number of rows per work item.
+constexpr int32_t kRowStripe = 16;
+
+// tan(22.5 degree)
+constexpr float kTan22 = 0.4142135623730950488f;
+
+/*
+ * Magnitude of one row. The norm is selected outside of the loops, so both
+ * loops are plain element wise code the compiler vectorizes.
+ */
+template < typename T >
+void calculateMagnitudeRow( const T* gxPtr, const T* gyPtr, float* magPtr,
+                            int32_t width, MagnitudeType magnitudeType )
+{
+    if ( magnitudeType == MagnitudeType::L2 )
+    {
+        for ( int32_t x = 0; x < width; x++ )
+        {
+            const auto gx = static_cast< float >( gxPtr[ x ] );
+            const auto gy = static_cast< float >( gyPtr[ x ] );
+            magPtr[ x ] = std::sqrt( gx * gx + gy * gy );
+        }
+    }
+    else
+    {
+        for ( int32_t x = 0; x < width; x++ )
+        {
+            magPtr[ x ] = std::fabs( static_cast< float >( gxPtr[ x ] ) ) +
+                          std::fabs( static_cast< float >( gyPtr[ x ] ) );
+        }
+    }
+}
+
+template < typename T >
+void computeMagnitudeRows( const cv::Mat& derivativeX,
+                           const cv::Mat& derivativeY, cv::Mat& magnitude,
+                           MagnitudeType magnitudeType, int32_t y0, int32_t y1 )
+{
+    for ( int32_t y = y0; y < y1; y++ )
+    {
+        calculateMagnitudeRow( derivativeX.ptr< T >( y ),
+                               derivativeY.ptr< T >( y ),
+                               magnitude.ptr< float >( y ),
+                               derivativeX.cols,
+                               magnitudeType );
+    }
+}
+
+/*
+ * Row source handing out the rows of precomputed derivative images.
+ */
+template < typename T >
+class DerivativeRows
+{
+public:
+    DerivativeRows( const cv::Mat& derivativeX, const cv::Mat& derivativeY )
+        : mDerivativeX( derivativeX )
+        , mDerivativeY( derivativeY )
+    {
+    }
+
+    std::pair< const T*, const T* > row( int32_t y ) const
+    {
+        return { mDerivativeX.ptr< T >( y ), mDerivativeY.ptr< T >( y ) };
+    }
+
+private:
+    const cv::Mat& mDerivativeX;
+    const cv::Mat& mDerivativeY;
+};
+
+/*
+ * Row source calculating the Sobel derivatives of an image row by row, with
+ * the same kernels, border handling (BORDER_REFLECT_101) and int16 saturation
+ * as cv::Sobel. The rows must be requested in increasing order. Rows of
+ * [y0, y1) are written to the derivative images, the rows right outside of
+ * that range only to internal buffers.
+ */
+class SobelRows
+{
+public:
+    SobelRows( const cv::Mat& imageIn, int32_t apertureSize,
+               cv::Mat& derivativeX, cv::Mat& derivativeY, int32_t y0,
+               int32_t y1 )
+        : mImageIn( imageIn )
+        , mDerivativeX( derivativeX )
+        , mDerivativeY( derivativeY )
+        , mY0( y0 )
+        , mY1( y1 )
+        , mRadius( apertureSize / 2 )
+    {
+        const auto width = static_cast< size_t >( imageIn.cols );
+        const auto size = static_cast< size_t >( apertureSize );
+
+        // Smoothing kernel: binomial coefficients of order size - 1
+        // Derivative kernel: binomial coefficients of order size - 2
+        // convolved with [-1, 1]
+        std::vector< int32_t > binomial { 1 };
+        for ( size_t i = 1; i < size - 1; i++ )
+        {
+            binomial.push_back( 0 );
+            for ( size_t j = binomial.size( ) - 1; j > 0; j-- )
+            {
+                binomial[ j ] += binomial[ j - 1 ];
+            }
+        }
+
+        mDerivativeKernel.assign( size, 0 );
+        mSmoothingKernel.assign( size, 0 );
+        for ( size_t i = 0; i < size - 1; i++ )
+        {
+            mDerivativeKernel[ i ] -= binomial[ i ];
+            mDerivativeKernel[ i + 1 ] += binomial[ i ];
+            mSmoothingKernel[ i ] += binomial[ i ];
+            mSmoothingKernel[ i + 1 ] += binomial[ i ];
+        }
+
+        mPaddedRow.resize( width + 2 * static_cast< size_t >( mRadius ) );
+        mDerivativeRing.assign( size, std::vector< int32_t >( width ) );
+        mSmoothingRing.assign( size, std::vector< int32_t >( width ) );
+
+        for ( auto& halo : mHaloX )
+        {
+            halo.resize( width );
+        }
+
+        for ( auto& halo : mHaloY )
+        {
+            halo.resize( width );
+        }
+    }
+
+    std::pair< const int16_t*, const int16_t* > row( int32_t y )
+    {
+        const auto width = mImageIn.cols;
+
+        // Filter the new input rows horizontally
+        for ( auto v = std::max( mNextRow, y - mRadius ); v <= y + mRadius;
+              v++ )
+        {
+            filterRow( v );
+        }
+
+        mNextRow = y + mRadius + 1;
+
+        int16_t* gxPtr { };
+        int16_t* gyPtr { };
+
+        if ( y >= mY0 && y < mY1 )
+        {
+            gxPtr = mDerivativeX.ptr< int16_t >( y );
+            gyPtr = mDerivativeY.ptr< int16_t >( y );
+        }
+        else
+        {
+            const size_t halo = y < mY0 ? 0 : 1;
+            gxPtr = mHaloX[ halo ].data( );
+            gyPtr = mHaloY[ halo ].data( );
+        }
+
+        // Filter vertically
+        for ( int32_t x = 0; x < width; x++ )
+        {
+            int32_t gx { };
+            int32_t gy { };
+
+            for ( int32_t i = -mRadius; i <= mRadius; i++ )
+            {
+                const auto slot = ringSlot( y + i );
+                const auto k = static_cast< size_t >( i + mRadius );
+                const auto xs = static_cast< size_t >( x );
+
+                gx += mSmoothingKernel[ k ] * mDerivativeRing[ slot ][ xs ];
+                gy += mDerivativeKernel[ k ] * mSmoothingRing[ slot ][ xs ];
+            }
+
+            gxPtr[ x ] = cv::saturate_cast< int16_t >( gx );
+            gyPtr[ x ] = cv::saturate_cast< int16_t >( gy );
+        }
+
+        return { gxPtr, gyPtr };
+    }
+
+private:
+    static int32_t reflect101( int32_t i, int32_t size )
+    {
+        if ( size == 1 )
+        {
+            return 0;
+        }
+
+        while ( i < 0 || i >= size )
+        {
+            i = i < 0 ? -i : 2 * size - 2 - i;
+        }
+
+        return i;
+    }
+
+    size_t ringSlot( int32_t v ) const
+    {
+        // v is never below -mRadius - 1
+        return static_cast< size_t >( v + 2 * mRadius + 1 ) %
+               mDerivativeRing.size( );
+    }
+
+    void filterRow( int32_t v )
+    {
+        const auto width = mImageIn.cols;
+        const auto srcPtr =
+            mImageIn.ptr< uint8_t >( reflect101( v, mImageIn.rows ) );
+
+        for ( int32_t x = -mRadius; x < width + mRadius; x++ )
+        {
+            mPaddedRow[ static_cast< size_t >( x + mRadius ) ] =
+                srcPtr[ reflect101( x, width ) ];
+        }
+
+        auto& derivativeRow = mDerivativeRing[ ringSlot( v ) ];
+        auto& smoothingRow = mSmoothingRing[ ringSlot( v ) ];
+        const auto size = mDerivativeKernel.size( );
+
+        for ( size_t x = 0; x < static_cast< size_t >( width ); x++ )
+        {
+            int32_t d { };
+            int32_t s { };
+
+            for ( size_t k = 0; k < size; k++ )
+            {
+                const auto value = mPaddedRow[ x + k ];
+                d += mDerivativeKernel[ k ] * value;
+                s += mSmoothingKernel[ k ] * value;
+            }
+
+            derivativeRow[ x ] = d;
+            smoothingRow[ x ] = s;
+        }
+    }
+
+    const cv::Mat& mImageIn;
+    cv::Mat& mDerivativeX;
+    cv::Mat& mDerivativeY;
+    int32_t mY0 { };
+    int32_t mY1 { };
+    int32_t mRadius { };
+
+    // The next input row that is not filtered horizontally yet
+    int32_t mNextRow { std::numeric_limits< int32_t >::min( ) };
+
+    std::vector< int32_t > mDerivativeKernel;
+    std::vector< int32_t > mSmoothingKernel;
+
+    std::vector< int32_t > mPaddedRow;
+
+    // Horizontally filtered input rows, one per kernel tap
+    std::vector< std::vector< int32_t > > mDerivativeRing;
+    std::vector< std::vector< int32_t > > mSmoothingRing;
+
+    // The rows above and below [y0, y1)
+    std::array< std::vector< int16_t >, 2 > mHaloX;
+    std::array< std::vector< int16_t >, 2 > mHaloY;
+};
+
+/*
+ * The values the non maximum suppression compares, as cv::Canny does for
+ * int16 derivatives: |gx| + |gy| or gx^2 + gy^2 in integers. The float
+ * magnitude of large L2 values is rounded and may tie where the squares do
+ * not. Float derivatives compare the float magnitude.
+ */
+void calculateKeyRow( const int16_t* gxPtr, const int16_t* gyPtr,
+                      int64_t* keyPtr, int32_t width,
+                      MagnitudeType magnitudeType )
+{
+    if ( magnitudeType == MagnitudeType::L2 )
+    {
+        for ( int32_t x = 0; x < width; x++ )
+        {
+            const auto gx = static_cast< int64_t >( gxPtr[ x ] );
+            const auto gy = static_cast< int64_t >( gyPtr[ x ] );
+            keyPtr[ x ] = gx * gx + gy * gy;
+        }
+    }
+    else
+    {
+        for ( int32_t x = 0; x < width; x++ )
+        {
+            keyPtr[ x ] = std::abs( static_cast< int64_t >( gxPtr[ x ] ) ) +
+                          std::abs( static_cast< int64_t >( gyPtr[ x ] ) );
+        }
+    }
+}
+
+void calculateKeyRow( const float* gxPtr, const float* gyPtr, float* keyPtr,
+                      int32_t width, MagnitudeType magnitudeType )
+{
+    calculateMagnitudeRow( gxPtr, gyPtr, keyPtr, width, magnitudeType );
+}
+
+// A threshold in the domain of the keys, squared and floored like cv::Canny
+template < typename Key >
+Key keyThreshold( double threshold, MagnitudeType magnitudeType )
+{
+    if constexpr ( std::is_same_v< Key, float > )
+    {
+        return static_cast< float >( threshold );
+    }
+    else
+    {
+        if ( magnitudeType == MagnitudeType::L2 )
+        {
+            threshold = std::min( 32767.0, threshold );
+
+            if ( threshold > 0.0 )
+            {
+                threshold *= threshold;
+            }
+        }
+
+        return static_cast< Key >( std::floor( threshold ) );
+    }
+}
+
+/*
+ * Quantized direction of an int16 gradient with the fixed point tangent of
+ * cv::Canny, tan(22.5 degree) * 2^15 rounded.
+ */
+uint8_t quantizeDirection( int16_t gx, int16_t gy )
+{
+    constexpr int32_t kCannyShift = 15;
+    constexpr int64_t kTan22Fixed = 13573;
+
+    const auto xs = std::abs( static_cast< int64_t >( gx ) );
+    const auto ys = std::abs( static_cast< int64_t >( gy ) ) << kCannyShift;
+    const auto tg22x = xs * kTan22Fixed;
+
+    if ( ys < tg22x )
+    {
+        return kDirectionHorizontal;
+    }
+
+    if ( ys > tg22x + ( xs << ( kCannyShift + 1 ) ) )
+    {
+        return kDirectionVertical;
+    }
+
+    return ( gx ^ gy ) < 0 ? kDirectionAntiDiagonal : kDirectionDiagonal;
+}
+
+// The same quantization in float
+uint8_t quantizeDirection( float gx, float gy )
+{
+    const auto xs = std::fabs( gx );
+    const auto ys = std::fabs( gy );
+    const auto tg22x = xs * kTan22;
+
+    if ( ys < tg22x )
+    {
+        return kDirectionHorizontal;
+    }
+
+    if ( ys > tg22x + 2.0f * xs )
+    {
+        return kDirectionVertical;
+    }
+
+    return ( gx < 0.0f ) != ( gy < 0.0f ) ? kDirectionAntiDiagonal
+                                          : kDirectionDiagonal;
+}
+
+/*
+ * Magnitude, direction quantization and non maximum suppression of the rows
+ * [y0, y1) in one sweep. The gradient rows come from the row source, the
+ * keys of three rows are kept in a ring with a zero border, so outside of
+ * the image the magnitude is zero. For int16 derivatives the result equals
+ * the one of cv::Canny.
+ */
+template < typename T, typename RowSource >
+void suppressRows( RowSource& source, double lowThreshold,
+                   double highThreshold, MagnitudeType magnitudeType,
+                   GradientPlanes& planes, int32_t y0, int32_t y1 )
+{
+    using Key = std::conditional_t< std::is_same_v< T, float >, float,
+                                    int64_t >;
+
+    const auto width = planes.magnitude.cols;
+    const auto height = planes.magnitude.rows;
+    const auto paddedWidth = static_cast< size_t >( width ) + 2;
+
+    const auto low = keyThreshold< Key >( lowThreshold, magnitudeType );
+    const auto high = keyThreshold< Key >( highThreshold, magnitudeType );
+
+    std::array< std::vector< Key >, 3 > keyRing;
+    std::array< std::pair< const T*, const T* >, 3 > gradientRing;
+
+    for ( auto& keyRow : keyRing )
+    {
+        keyRow.assign( paddedWidth, Key { } );
+    }
+
+    const auto slot = []( int32_t y )
+    { return static_cast< size_t >( y + 3 ) % 3; };
+
+    const auto loadRow = [ & ]( int32_t y )
+    {
+        auto& keyRow = keyRing[ slot( y ) ];
+
+        if ( y < 0 || y >= height )
+        {
+            std::fill( keyRow.begin( ), keyRow.end( ), Key { } );
+            return;
+        }
+
+        const auto gradient = source.row( y );
+        gradientRing[ slot( y ) ] = gradient;
+
+        calculateKeyRow( gradient.first,
+                         gradient.second,
+                         keyRow.data( ) + 1,
+                         width,
+                         magnitudeType );
+    };
+
+    loadRow( y0 - 1 );
+    loadRow( y0 );
+
+    for ( int32_t y = y0; y < y1; y++ )
+    {
+        loadRow( y + 1 );
+
+        const auto keyP = keyRing[ slot( y - 1 ) ].data( ) + 1;
+        const auto keyA = keyRing[ slot( y ) ].data( ) + 1;
+        const auto keyN = keyRing[ slot( y + 1 ) ].data( ) + 1;
+
+        const auto gxPtr = gradientRing[ slot( y ) ].first;
+        const auto gyPtr = gradientRing[ slot( y ) ].second;
+
+        const auto magPtr = planes.magnitude.ptr< float >( y );
+        const auto dirPtr = planes.direction.ptr< uint8_t >( y );
+        const auto classPtr = planes.edgeClasses.ptr< uint8_t >( y );
+
+        if constexpr ( std::is_same_v< Key, float > )
+        {
+            std::copy( keyA, keyA + width, magPtr );
+        }
+        else
+        {
+            calculateMagnitudeRow(
+                gxPtr, gyPtr, magPtr, width, magnitudeType );
+        }
+
+        for ( int32_t x = 0; x < width; x++ )
+        {
+            const auto m = keyA[ x ];
+            const auto direction = quantizeDirection( gxPtr[ x ], gyPtr[ x ] );
+
+            bool isMaximum { };
+
+            switch ( direction )
+            {
+            case kDirectionHorizontal:
+                isMaximum = m > keyA[ x - 1 ] && m >= keyA[ x + 1 ];
+                break;
+            case kDirectionVertical:
+                isMaximum = m > keyP[ x ] && m >= keyN[ x ];
+                break;
+            case kDirectionDiagonal:
+                isMaximum = m > keyP[ x - 1 ] && m > keyN[ x + 1 ];
+                break;
+            default:
+                isMaximum = m > keyP[ x + 1 ] && m > keyN[ x - 1 ];
+                break;
+            }
+
+            dirPtr[ x ] = direction;
+
+            if ( ! isMaximum || m <= low )
+            {
+                classPtr[ x ] = kNoEdge;
+            }
+            else
+            {
+                classPtr[ x ] = m > high ? kStrongEdge : kWeakEdge;
+            }
+        }
+    }
+}
+
+void createPlanes( const cv::Size& size, GradientPlanes& planes )
+{
+    planes.magnitude.create( size, CV_32FC1 );
+    planes.direction.create( size, CV_8UC1 );
+    planes.edgeClasses.create( size, CV_8UC1 );
+}
+} // namespace
+
+void computeMagnitude( const cv::Mat& derivativeX, const cv::Mat& derivativeY,
+                       cv::Mat& magnitude, MagnitudeType magnitudeType,
+                       ThreadPool* threadPool )
+{
+    CV_Assert( derivativeX.type( ) == derivativeY.type( ) );
+    CV_Assert( derivativeX.size( ) == derivativeY.size( ) );
+
+    magnitude.create( derivativeX.size( ), CV_32FC1 );
+
+    parallelFor( threadPool,
+                 0,
+                 derivativeX.rows,
+                 kRowStripe,
+                 [ & ]( int32_t y0, int32_t y1 )
+                 {
+                     switch ( derivativeX.type( ) )
+                     {
+                     case CV_16SC1:
+                         computeMagnitudeRows< int16_t >( derivativeX,
+                                                          derivativeY,
+                                                          magnitude,
+                                                          magnitudeType,
+                                                          y0,
+                                                          y1 );
+                         break;
+                     case CV_32FC1:
+                         computeMagnitudeRows< float >( derivativeX,
+                                                        derivativeY,
+                                                        magnitude,
+                                                        magnitudeType,
+                                                        y0,
+                                                        y1 );
+                         break;
+                     default:
+                         throw std::invalid_argument(
+                             "Derivatives must be CV_16SC1 or CV_32FC1" );
+                     }
+                 } );
+}
+
+void nonMaximumSuppression( const cv::Mat& derivativeX,
+                            const cv::Mat& derivativeY, double lowThreshold,
+                            double highThreshold, GradientPlanes& planes,
+                            MagnitudeType magnitudeType,
+                            ThreadPool* threadPool )
+{
+    CV_Assert( derivativeX.type( ) == derivativeY.type( ) );
+    CV_Assert( derivativeX.size( ) == derivativeY.size( ) );
+
+    planes.derivativeX = derivativeX;
+    planes.derivativeY = derivativeY;
+    createPlanes( derivativeX.size( ), planes );
+
+    if ( lowThreshold > highThreshold )
+    {
+        std::swap( lowThreshold, highThreshold );
+    }
+
+    parallelFor(
+        threadPool,
+        0,
+        derivativeX.rows,
+        kRowStripe,
+        [ & ]( int32_t y0, int32_t y1 )
+        {
+            switch ( derivativeX.type( ) )
+            {
+            case CV_16SC1:
+            {
+                DerivativeRows< int16_t > source( derivativeX, derivativeY );
+                suppressRows< int16_t >( source,
+                                         lowThreshold,
+                                         highThreshold,
+                                         magnitudeType,
+                                         planes,
+                                         y0,
+                                         y1 );
+                break;
+            }
+            case CV_32FC1:
+            {
+                DerivativeRows< float > source( derivativeX, derivativeY );
+                suppressRows< float >( source,
+                                      lowThreshold,
+                                      highThreshold,
+                                      magnitudeType,
+                                      planes,
+                                      y0,
+                                      y1 );
+                break;
+            }
+            default:
+                throw std::invalid_argument(
+                    "Derivatives must be CV_16SC1 or CV_32FC1" );
+            }
+        } );
+}
+
+void sobelNonMaximumSuppression( const cv::Mat& imageIn, int32_t apertureSize,
+                                 double lowThreshold, double highThreshold,
+                                 GradientPlanes& planes,
+                                 MagnitudeType magnitudeType,
+                                 ThreadPool* threadPool )
+{
+    CV_Assert( imageIn.type( ) == CV_8UC1 );
+
+    // The fused sweep has the kernels 3, 5 and 7. The others cv::Sobel
+    // accepts, 1 and Scharr (-1), are derived first and suppressed after.
+    if ( apertureSize != 3 && apertureSize != 5 && apertureSize != 7 )
+    {
+        cv::Mat derivativeX;
+        cv::Mat derivativeY;
+        cv::Sobel( imageIn, derivativeX, CV_16SC1, 1, 0, apertureSize );
+        cv::Sobel( imageIn, derivativeY, CV_16SC1, 0, 1, apertureSize );
+
+        nonMaximumSuppression( derivativeX,
+                               derivativeY,
+                               lowThreshold,
+                               highThreshold,
+                               planes,
+                               magnitudeType,
+                               threadPool );
+        return;
+    }
+
+    planes.derivativeX.create( imageIn.size( ), CV_16SC1 );
+    planes.derivativeY.create( imageIn.size( ), CV_16SC1 );
+    createPlanes( imageIn.size( ), planes );
+
+    if ( lowThreshold > highThreshold )
+    {
+        std::swap( lowThreshold, highThreshold );
+    }
+
+    parallelFor( threadPool,
+                 0,
+                 imageIn.rows,
+                 kRowStripe,
+                 [ & ]( int32_t y0, int32_t y1 )
+                 {
+                     SobelRows source( imageIn,
+                                       apertureSize,
+                                       planes.derivativeX,
+                                       planes.derivativeY,
+                                       y0,
+                                       y1 );
+                     suppressRows< int16_t >( source,
+                                              lowThreshold,
+                                              highThreshold,
+                                              magnitudeType,
+                                              planes,
+                                              y0,
+                                              y1 );
+                 } );
+}
+
+void hysteresis( const cv::Mat& edgeClasses, EdgeBitmap& edges )
+{
+    const auto width = edgeClasses.cols;
+    const auto height = edgeClasses.rows;
+
+    edges.create( height, width );
+
+    std::vector< cv::Point2i > stack;
+
+    const auto push = [ & ]( int32_t x, int32_t y )
+    {
+        if ( ! edges.test( x, y ) &&
+             edgeClasses.ptr< uint8_t >( y )[ x ] != kNoEdge )
+        {
+            edges.set( x, y );
+            stack.emplace_back( x, y );
+        }
+    };
+
+    for ( int32_t y = 0; y < height; y++ )
+    {
+        const auto classPtr = edgeClasses.ptr< uint8_t >( y );
+
+        for ( int32_t x = 0; x < width; x++ )
+        {
+            if ( classPtr[ x ] != kStrongEdge )
+            {
+                continue;
+            }
+
+            push( x, y );
+
+            // Follow the weak pixels connected to this strong pixel
+            while ( ! stack.empty( ) )
+            {
+                const auto point = stack.back( );
+                stack.pop_back( );
+
+                for ( int32_t dy = -1; dy <= 1; dy++ )
+                {
+                    for ( int32_t dx = -1; dx <= 1; dx++ )
+                    {
+                        const auto nx = point.x + dx;
+                        const auto ny = point.y + dy;
+
+                        if ( nx >= 0 && nx < width && ny >= 0 && ny < height )
+                        {
+                            push( nx, ny );
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Thin by construction
+    edges.removeRedundantPixels( );
+}
+
+void hysteresis( const cv::Mat& edgeClasses, cv::Mat& edges )
+{
+    EdgeBitmap edgeMap;
+    hysteresis( edgeClasses, edgeMap );
+
+    edgeMap.copyTo( edges );
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+// OpenCV includes
+#include <opencv2/core.hpp>
+
+class EdgeBitmap;
+class ThreadPool;
+
+// Pixel classes written by nonMaximumSuppression
+constexpr uint8_t kNoEdge = 0;
+constexpr uint8_t kWeakEdge = 1;
+constexpr uint8_t kStrongEdge = 2;
+
+// Quantized gradient directions written by the non maximum suppression
+constexpr uint8_t kDirectionHorizontal = 0;
+constexpr uint8_t kDirectionVertical = 1;
+// Gradient along (1, 1), gx and gy have the same sign
+constexpr uint8_t kDirectionDiagonal = 2;
+// Gradient along (1, -1), gx and gy have different signs
+constexpr uint8_t kDirectionAntiDiagonal = 3;
+
+enum class MagnitudeType
+{
+    // |gx| + |gy|, as cv::Canny by default
+    L1,
+    // sqrt(gx^2 + gy^2)
+    L2
+};
+
+struct GradientPlanes
+{
+    // The derivatives (CV_16SC1 or CV_32FC1)
+    cv::Mat derivativeX;
+    cv::Mat derivativeY;
+
+    // The L1 or L2 magnitude (CV_32FC1)
+    cv::Mat magnitude;
+
+    // The quantized gradient direction (CV_8UC1)
+    cv::Mat direction;
+
+    // kNoEdge, kWeakEdge or kStrongEdge per pixel (CV_8UC1)
+    cv::Mat edgeClasses;
+};
+
+/*
+ * Function that calculates the gradient magnitude plane.
+ *
+ * @param [in]  derivativeX     The derivative in x direction
+ *                              (CV_16SC1, CV_32FC1)
+ * @param [in]  derivativeY     The derivative in y direction, same type
+ * @param [out] magnitude       The magnitude (CV_32FC1)
+ * @param [in]  magnitudeType   The norm to use
+ * @param [in]  threadPool      Optional thread pool
+ */
+void computeMagnitude( const cv::Mat& derivativeX, const cv::Mat& derivativeY,
+                       cv::Mat& magnitude,
+                       MagnitudeType magnitudeType = MagnitudeType::L1,
+                       ThreadPool* threadPool = nullptr );
+
+/*
+ * Function that calculates magnitude, quantized direction and the non maximum
+ * suppression of precomputed derivatives in one sweep. A pixel survives if its
+ * magnitude is a local maximum along the gradient direction, which is
+ * quantized to horizontal, vertical and the two diagonals as done by
+ * cv::Canny. Surviving pixels are classified as weak (magnitude above the low
+ * threshold) or strong (magnitude above the high threshold). Int16
+ * derivatives are compared in integers like cv::Canny, so the hysteresis of
+ * the classes gives its edges.
+ *
+ * The derivative images are shared with planes, not copied.
+ *
+ * @param [in]  derivativeX     The derivative in x direction
+ *                              (CV_16SC1, CV_32FC1)
+ * @param [in]  derivativeY     The derivative in y direction, same type
+ * @param [in]  lowThreshold    The low threshold
+ * @param [in]  highThreshold   The high threshold
+ * @param [out] planes          The gradient planes
+ * @param [in]  magnitudeType   The norm of the magnitude
+ * @param [in]  threadPool      Optional thread pool
+ */
+void nonMaximumSuppression( const cv::Mat& derivativeX,
+                            const cv::Mat& derivativeY, double lowThreshold,
+                            double highThreshold, GradientPlanes& planes,
+                            MagnitudeType magnitudeType = MagnitudeType::L1,
+                            ThreadPool* threadPool = nullptr );
+
+/*
+ * Function that calculates the Sobel derivatives together with magnitude,
+ * quantized direction and non maximum suppression in one sweep over the
+ * image. Each row stripe keeps only the few rows needed by the kernels in
+ * flight, so every value is computed once per pixel while it is in cache.
+ * The derivatives equal the CV_16S output of cv::Sobel.
+ *
+ * The apertures 1 and -1 (Scharr) are not fused, their derivatives are
+ * calculated by cv::Sobel and suppressed by nonMaximumSuppression.
+ *
+ * @param [in]  imageIn         The input image (CV_8UC1)
+ * @param [in]  apertureSize    The Sobel aperture size, 1, 3, 5, 7 or -1
+ * @param [in]  lowThreshold    The low threshold
+ * @param [in]  highThreshold   The high threshold
+ * @param [out] planes          The gradient planes, derivatives CV_16SC1
+ * @param [in]  magnitudeType   The norm of the magnitude
+ * @param [in]  threadPool      Optional thread pool
+ */
+void sobelNonMaximumSuppression(
+    const cv::Mat& imageIn, int32_t apertureSize, double lowThreshold,
+    double highThreshold, GradientPlanes& planes,
+    MagnitudeType magnitudeType = MagnitudeType::L1,
+    ThreadPool* threadPool = nullptr );
+
+/*
+ * Function that keeps all strong pixels and all weak pixels connected to a
+ * strong pixel through 8 connected weak pixels, and removes the pixels not
+ * needed for the 8 connectivity, see EdgeBitmap::removeRedundantPixels. The
+ * quantized non maximum suppression leaves staircase corners and small
+ * blocks where the direction changes, the result has none of them and is one
+ * pixel wide everywhere, so no thinning is needed.
+ *
+ * @param [in]  edgeClasses The output of nonMaximumSuppression
+ * @param [out] edges       The edge bitmap
+ */
+void hysteresis( const cv::Mat& edgeClasses, EdgeBitmap& edges );
+
+/*
+ * Function that runs the hysteresis like above and writes the edges as an
+ * image.
+ *
+ * @param [in]  edgeClasses The output of nonMaximumSuppression
+ * @param [out] edges       The edge image (CV_8UC1, 0 or 255)
+ */
+void hysteresis( const cv::Mat& edgeClasses, cv::Mat& edges );
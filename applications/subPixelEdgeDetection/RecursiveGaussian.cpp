@@ -0,0 +1,408 @@
+#include "RecursiveGaussian.h"
+#include "ThreadPool.h"
+
+// Std includes
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+namespace
+{
+// Number of rows per work item of the horizontal pass.
+constexpr int32_t kRowStripe = 8;
+
+// Granularity of the column ranges of the vertical pass.
+constexpr int32_t kColumnBlock = 16;
+
+struct RecursiveGaussianCoefficients
+{
+    // Weight of the input sample
+    float b;
+    // Weights of the last three output samples
+    float b1;
+    float b2;
+    float b3;
+    // Maps the deviations of the last three causal outputs from the border
+    // pixel to the deviations of the first three anti causal outputs behind
+    // the border, see Triggs and Sdika: "Boundary conditions for Young - van
+    // Vliet recursive filtering"
+    std::array< std::array< float, 3 >, 3 > border;
+};
+
+// Poles of the third order filter for sigma 2, table 1 of van Vliet, Young
+// and Verbeek: "Recursive Gaussian derivative filters"
+constexpr std::array< std::complex< double >, 3 > kPoles = {
+    std::complex< double >( 1.41650, 1.00829 ),
+    std::complex< double >( 1.41650, -1.00829 ),
+    std::complex< double >( 1.86543, 0.0 ) };
+
+// The poles for another sigma, d^(1 / q)
+std::array< std::complex< double >, 3 > scaledPoles( double q )
+{
+    std::array< std::complex< double >, 3 > poles;
+
+    for ( size_t i = 0; i < poles.size( ); i++ )
+    {
+        poles[ i ] = std::polar( std::pow( std::abs( kPoles[ i ] ), 1.0 / q ),
+                                 std::arg( kPoles[ i ] ) / q );
+    }
+
+    return poles;
+}
+
+// The variance of the causal and anti causal filter with the given poles
+double filterVariance( const std::array< std::complex< double >, 3 >& poles )
+{
+    std::complex< double > variance;
+
+    for ( const auto& d : poles )
+    {
+        variance += 2.0 * d / ( ( d - 1.0 ) * ( d - 1.0 ) );
+    }
+
+    return variance.real( );
+}
+
+/*
+ * Function that calculates the boundary matrix of the coefficients. Behind
+ * the border the input is the border pixel, so the causal and the anti causal
+ * filter only carry the deviation of the last causal outputs from it. The
+ * matrix is the response to each of these deviations, evaluated until it has
+ * decayed.
+ *
+ * @param [in,out] coeff    The coefficients, the border matrix is written
+ * @param [in]  decay       The largest magnitude of the inverse poles
+ */
+void calculateBorderMatrix( RecursiveGaussianCoefficients& coeff,
+                            double decay )
+{
+    const auto length = static_cast< size_t >(
+        std::ceil( std::log( 1e-10 ) / std::log( decay ) ) ) + 3;
+
+    std::vector< double > causal( length );
+    std::vector< double > antiCausal( length + 3 );
+
+    for ( size_t i = 0; i < 3; i++ )
+    {
+        std::array< double, 3 > history { };
+        history[ i ] = 1.0;
+
+        for ( auto& w : causal )
+        {
+            w = coeff.b1 * history[ 0 ] + coeff.b2 * history[ 1 ] +
+                coeff.b3 * history[ 2 ];
+            history = { w, history[ 0 ], history[ 1 ] };
+        }
+
+        for ( size_t x = length; x-- > 0; )
+        {
+            antiCausal[ x ] = coeff.b * causal[ x ] +
+                              coeff.b1 * antiCausal[ x + 1 ] +
+                              coeff.b2 * antiCausal[ x + 2 ] +
+                              coeff.b3 * antiCausal[ x + 3 ];
+        }
+
+        for ( size_t j = 0; j < 3; j++ )
+        {
+            coeff.border[ j ][ i ] = static_cast< float >( antiCausal[ j ] );
+        }
+    }
+}
+
+RecursiveGaussianCoefficients calculateCoefficients( double sigma )
+{
+    // The variance grows with q, the bisection finds the q of sigma. Below
+    // 0.35 the scaled poles do not describe a Gaussian anymore.
+    auto qLow = 0.35;
+    auto qHigh = std::max( sigma, 1.0 );
+
+    for ( int32_t i = 0; i < 64; i++ )
+    {
+        const auto q = 0.5 * ( qLow + qHigh );
+
+        if ( filterVariance( scaledPoles( q ) ) < sigma * sigma )
+        {
+            qLow = q;
+        }
+        else
+        {
+            qHigh = q;
+        }
+    }
+
+    const auto poles = scaledPoles( 0.5 * ( qLow + qHigh ) );
+
+    // The denominator (1 - z^-1 / d1) (1 - z^-1 / d2) (1 - z^-1 / d3), the
+    // first two poles are conjugated
+    const auto p1 = 1.0 / poles[ 0 ];
+    const auto p3 = 1.0 / poles[ 2 ].real( );
+    const auto p1Squared = std::norm( p1 );
+
+    const auto b1 = 2.0 * p1.real( ) + p3;
+    const auto b2 = -( p1Squared + 2.0 * p1.real( ) * p3 );
+    const auto b3 = p1Squared * p3;
+
+    RecursiveGaussianCoefficients coeff { };
+    coeff.b = static_cast< float >( 1.0 - ( b1 + b2 + b3 ) );
+    coeff.b1 = static_cast< float >( b1 );
+    coeff.b2 = static_cast< float >( b2 );
+    coeff.b3 = static_cast< float >( b3 );
+
+    calculateBorderMatrix( coeff, std::max( std::abs( p1 ), p3 ) );
+
+    return coeff;
+}
+
+/*
+ * Function that calculates the first three anti causal outputs behind the
+ * border from the last three causal outputs.
+ *
+ * @param [in]  last1   The last causal output
+ * @param [in]  last2   The causal output before
+ * @param [in]  last3   The causal output before that
+ * @param [in]  border  The border pixel
+ * @param [in]  coeff   The filter coefficients
+ * @param [out] history The anti causal outputs, nearest to the border first
+ */
+inline void antiCausalBorder( float last1, float last2, float last3,
+                              float border,
+                              const RecursiveGaussianCoefficients& coeff,
+                              std::array< float, 3 >& history )
+{
+    for ( size_t j = 0; j < 3; j++ )
+    {
+        history[ j ] = border +
+                       coeff.border[ j ][ 0 ] * ( last1 - border ) +
+                       coeff.border[ j ][ 1 ] * ( last2 - border ) +
+                       coeff.border[ j ][ 2 ] * ( last3 - border );
+    }
+}
+
+/*
+ * Smooths a single row in both directions.
+ *
+ * w(x)   = b * I(x) + b1 * w(x - 1) + b2 * w(x - 2) + b3 * w(x - 3)
+ * out(x) = b * w(x) + b1 * out(x + 1) + b2 * out(x + 2) + b3 * out(x + 3)
+ *
+ * @param [in]  srcPtr  The input row
+ * @param [out] dstPtr  The output row
+ * @param [in]  width   The number of pixels in the row
+ * @param [in]  coeff   The filter coefficients
+ */
+void smoothRow( const uint8_t* srcPtr, float* dstPtr, int32_t width,
+                const RecursiveGaussianCoefficients& coeff )
+{
+    // Left to right, the steady state of a constant border is the border
+    float w1 = srcPtr[ 0 ];
+    float w2 = w1;
+    float w3 = w1;
+
+    for ( int32_t x = 0; x < width; x++ )
+    {
+        const float w = coeff.b * srcPtr[ x ] + coeff.b1 * w1 + coeff.b2 * w2 +
+                        coeff.b3 * w3;
+        dstPtr[ x ] = w;
+        w3 = w2;
+        w2 = w1;
+        w1 = w;
+    }
+
+    // Right to left, in place. Left of the row the causal output is the
+    // border pixel, which only matters for rows shorter than three pixels.
+    const auto causal = [ & ]( int32_t xc )
+    { return xc < 0 ? static_cast< float >( srcPtr[ 0 ] ) : dstPtr[ xc ]; };
+
+    std::array< float, 3 > history;
+    antiCausalBorder( causal( width - 1 ),
+                      causal( width - 2 ),
+                      causal( width - 3 ),
+                      srcPtr[ width - 1 ],
+                      coeff,
+                      history );
+
+    w1 = history[ 0 ];
+    w2 = history[ 1 ];
+    w3 = history[ 2 ];
+
+    for ( int32_t x = width - 1; x >= 0; x-- )
+    {
+        const float w = coeff.b * dstPtr[ x ] + coeff.b1 * w1 + coeff.b2 * w2 +
+                        coeff.b3 * w3;
+        dstPtr[ x ] = w;
+        w3 = w2;
+        w2 = w1;
+        w1 = w;
+    }
+}
+
+/*
+ * One step of the vertical recursion for the columns [x0, x1). The three
+ * previous rows are the ones already filtered, row y is filtered in place.
+ *
+ * @param [in,out] rowPtr  The row to filter
+ * @param [in]  prev1Ptr   The previous row in filter direction
+ * @param [in]  prev2Ptr   The row before the previous row
+ * @param [in]  prev3Ptr   The row before that
+ * @param [in]  x0         The first column
+ * @param [in]  x1         The column behind the last column
+ * @param [in]  coeff      The filter coefficients
+ */
+inline void smoothColumnStep( float* rowPtr, const float* prev1Ptr,
+                              const float* prev2Ptr, const float* prev3Ptr,
+                              int32_t x0, int32_t x1,
+                              const RecursiveGaussianCoefficients& coeff )
+{
+    for ( int32_t x = x0; x < x1; x++ )
+    {
+        rowPtr[ x ] = coeff.b * rowPtr[ x ] + coeff.b1 * prev1Ptr[ x ] +
+                      coeff.b2 * prev2Ptr[ x ] + coeff.b3 * prev3Ptr[ x ];
+    }
+}
+
+/*
+ * Smooths the columns [x0, x1) of the float image in place and writes the
+ * result to the output image. The rows are processed in order, so all columns
+ * of the range are filtered together as independent lanes.
+ *
+ * @param [in,out] imageS   The horizontally smoothed image (CV_32FC1)
+ * @param [out] imageOut    The output image (CV_8UC1)
+ * @param [in]  x0          The first column
+ * @param [in]  x1          The column behind the last column
+ * @param [in]  coeff       The filter coefficients
+ */
+void smoothColumns( cv::Mat& imageS, cv::Mat& imageOut, int32_t x0, int32_t x1,
+                    const RecursiveGaussianCoefficients& coeff )
+{
+    const auto height = imageS.rows;
+    const auto cols = static_cast< size_t >( imageS.cols );
+
+    // Rows above the image are replaced by the unfiltered top row, which
+    // gives the steady state of a constant border. The unfiltered bottom row
+    // is kept for the rows below the image. Only the own columns are copied,
+    // the other columns may be filtered concurrently.
+    std::vector< float > topRow( cols );
+    std::vector< float > bottomRow( cols );
+
+    const auto copyRow = [ & ]( int32_t y, std::vector< float >& row )
+    {
+        const auto sPtr = imageS.ptr< float >( y );
+        std::copy( sPtr + x0, sPtr + x1, row.begin( ) + x0 );
+    };
+
+    copyRow( 0, topRow );
+    copyRow( height - 1, bottomRow );
+
+    const auto causalPtr = [ & ]( int32_t yc ) -> const float*
+    { return yc < 0 ? topRow.data( ) : imageS.ptr< float >( yc ); };
+
+    // Top to bottom
+    for ( int32_t y = 0; y < height; y++ )
+    {
+        smoothColumnStep( imageS.ptr< float >( y ),
+                          causalPtr( y - 1 ),
+                          causalPtr( y - 2 ),
+                          causalPtr( y - 3 ),
+                          x0,
+                          x1,
+                          coeff );
+    }
+
+    // The three anti causal rows below the image
+    std::array< std::vector< float >, 3 > belowRows;
+    for ( auto& row : belowRows )
+    {
+        row.resize( cols );
+    }
+
+    const auto last1Ptr = causalPtr( height - 1 );
+    const auto last2Ptr = causalPtr( height - 2 );
+    const auto last3Ptr = causalPtr( height - 3 );
+
+    for ( int32_t x = x0; x < x1; x++ )
+    {
+        std::array< float, 3 > history;
+        antiCausalBorder( last1Ptr[ x ],
+                          last2Ptr[ x ],
+                          last3Ptr[ x ],
+                          bottomRow[ x ],
+                          coeff,
+                          history );
+
+        for ( size_t j = 0; j < history.size( ); j++ )
+        {
+            belowRows[ j ][ x ] = history[ j ];
+        }
+    }
+
+    const auto antiCausalPtr = [ & ]( int32_t ya ) -> const float*
+    {
+        return ya >= height ? belowRows[ ya - height ].data( )
+                            : imageS.ptr< float >( ya );
+    };
+
+    // Bottom to top
+    for ( int32_t y = height - 1; y >= 0; y-- )
+    {
+        smoothColumnStep( imageS.ptr< float >( y ),
+                          antiCausalPtr( y + 1 ),
+                          antiCausalPtr( y + 2 ),
+                          antiCausalPtr( y + 3 ),
+                          x0,
+                          x1,
+                          coeff );
+
+        const auto sPtr = imageS.ptr< float >( y );
+        const auto dstPtr = imageOut.ptr< uint8_t >( y );
+
+        for ( int32_t x = x0; x < x1; x++ )
+        {
+            dstPtr[ x ] = cv::saturate_cast< uint8_t >( sPtr[ x ] );
+        }
+    }
+}
+} // namespace
+
+double gaussianSigma( int32_t kernelSize )
+{
+    return 0.3 * ( ( kernelSize - 1 ) * 0.5 - 1 ) + 0.8;
+}
+
+void recursiveGaussianBlur( const cv::Mat& imageIn, cv::Mat& imageOut,
+                            double sigma, ThreadPool* threadPool )
+{
+    CV_Assert( imageIn.type( ) == CV_8UC1 );
+    CV_Assert( sigma >= 0.5 );
+
+    const auto coeff = calculateCoefficients( sigma );
+
+    cv::Mat imageS( imageIn.size( ), CV_32FC1 );
+
+    // Rows -> horizontal filter
+    parallelFor( threadPool,
+                 0,
+                 imageIn.rows,
+                 kRowStripe,
+                 [ & ]( int32_t y0, int32_t y1 )
+                 {
+                     for ( int32_t y = y0; y < y1; y++ )
+                     {
+                         smoothRow( imageIn.ptr< uint8_t >( y ),
+                                    imageS.ptr< float >( y ),
+                                    imageIn.cols,
+                                    coeff );
+                     }
+                 } );
+
+    // The input is not read anymore, so it may be the output
+    imageOut.create( imageIn.size( ), CV_8UC1 );
+
+    // Cols -> vertical filter
+    parallelFor( threadPool,
+                 0,
+                 imageIn.cols,
+                 kColumnBlock,
+                 [ & ]( int32_t x0, int32_t x1 )
+                 { smoothColumns( imageS, imageOut, x0, x1, coeff ); } );
+}
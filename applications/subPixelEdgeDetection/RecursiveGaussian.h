@@ -0,0 +1,38 @@
+#pragma once
+
+// OpenCV includes
+#include <opencv2/core.hpp>
+
+class ThreadPool;
+
+/*
+ * Function that returns the sigma cv::GaussianBlur uses for the given kernel
+ * size if no sigma is given.
+ *
+ * @param [in]  kernelSize  The odd kernel size
+ * @returns The sigma
+ */
+double gaussianSigma( int32_t kernelSize );
+
+/*
+ * Function that smooths an image with the recursive Gaussian filter from van
+ * Vliet, Young and Verbeek: "Recursive Gaussian derivative filters". Each
+ * direction runs a third order causal and anti causal recursion, so the cost
+ * per pixel does not depend on sigma. The borders are extended with the
+ * border pixel, the recursions start in the steady state of the extension.
+ *
+ * Against cv::GaussianBlur with a replicated border and the sigma of
+ * gaussianSigma the result is within 3 grey levels for kernel sizes from 7.
+ * cv::GaussianBlur takes the kernel sizes 3 and 5 from fixed binomial tables,
+ * which the recursion only approximates: up to 20 grey levels on noise.
+ *
+ * The row pass is split into row stripes and the column pass into column
+ * ranges if a thread pool is given. The result does not depend on the pool.
+ *
+ * @param [in]  imageIn     The input image (CV_8UC1)
+ * @param [out] imageOut    The smoothed image (CV_8UC1), may be imageIn
+ * @param [in]  sigma       The standard deviation, at least 0.5
+ * @param [in]  threadPool  Optional thread pool
+ */
+void recursiveGaussianBlur( const cv::Mat& imageIn, cv::Mat& imageOut,
+                            double sigma, ThreadPool* threadPool = nullptr );
@@ -1,9 +1,21 @@
 #include "SubPixelDetection.h"
 #include "Deriche.h"
+#include "EdgeBitmap.h"
+#include "EdgeChains.h"
+#include "FacetPlanes.h"
+#include "FrameArena.h"
 #include "Graph.h"
+#include "NonMaximumSuppression.h"
+#include "RecursiveGaussian.h"
+#include "ThreadPool.h"
 
 // Std includes
+#include <algorithm>
+#include <array>
+#include <bitset>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
 
 // OpenCV includes
 #include <opencv2/imgproc.hpp>
@@ -22,6 +34,17 @@ enum class Neighbourhood
     EightConnected
 };
 
+// The neighbour of the parabolic interpolation per quantized direction,
+// indexed by kDirectionHorizontal to kDirectionAntiDiagonal
+constexpr std::array< int32_t, 4 > kInterpolationStepX { { 1, 0, 1, 1 } };
+constexpr std::array< int32_t, 4 > kInterpolationStepY { { 0, 1, 1, -1 } };
+
+// Number of points the batched interpolation processes at once
+constexpr size_t kInterpolationBlock = 256;
+
+// Number of points per work item of the subpixel extraction
+constexpr int32_t kPointStripe = 256;
+
 //
 // isEqual - Any arithmetic type
 //
@@ -56,117 +79,346 @@ isZero( T val, T epsilon = std::numeric_limits< T >::epsilon( ) )
     }
 }
 
-std::vector< std::vector< cv::Point2i > >
-labelContours( const cv::Mat& imageIn );
-
-void checkNeighbourhood( int32_t x, int32_t y, const cv::Mat& refTable,
-                         std::vector< int32_t >& neighbourhood );
-
-int32_t smallestNeighbour( const std::vector< int32_t >& neighbourhood,
-                           const std::vector< int32_t >& activeLabels );
-
-void createElement(
-    int32_t x, int32_t y,
-    std::vector< std::shared_ptr< std::vector< cv::Point2i > > >& objects,
-    std::vector< int32_t >& activeLabels, int32_t labelNumber );
-
-void addElement(
-    int32_t x, int32_t y, int32_t labelNumber,
-    const std::vector< std::shared_ptr< std::vector< cv::Point2i > > >&
-        objects );
-
-void mergeElement(
-    const std::vector< int32_t >& neighbourhood, int32_t newLabelNumber,
-    std::vector< std::shared_ptr< std::vector< cv::Point2i > > >& objects,
-    std::vector< int32_t >& activeLabels );
+int32_t findLabelRoot( std::pmr::vector< int32_t >& parents, int32_t label );
 
-std::vector< std::vector< cv::Point2i > > calculateShortestPathsDijkstra(
+std::pmr::vector< std::pmr::vector< cv::Point2i > >
+calculateShortestPathsDijkstra(
     const std::vector< cv::Point2i >& unorderedContourPoints,
-    const cv::Mat& imageCanny );
+    const EdgeBitmap& edges, cv::Mat& indexImage,
+    std::pmr::memory_resource* resource );
 
-int32_t countNeighbours( const cv::Point2i& pos, const cv::Mat& imageIn,
+int32_t countNeighbours( uint8_t neighbours,
                          const SearchDirection direction );
 
-int32_t countNeighbours( const cv::Point2i& pos, const cv::Mat& imageIn,
+int32_t countNeighbours( uint8_t neighbours,
                          const Neighbourhood neighbourhood );
 
-uint8_t getPixelValue( const cv::Mat& mat, const cv::Point2i& point );
-
 std::vector< size_t >
 findPossibleStartPoints( const std::vector< cv::Point2i >& contourPoints,
-                         const cv::Mat& imageIn );
+                         const EdgeBitmap& edges );
 
 std::vector< cv::Point2i >
-traceContourPavlidis( const cv::Mat& imageIn, const cv::Point2i& startPoint );
-
-std::unique_ptr< Graph >
-calculateAdjacencyMatrix( const std::vector< cv::Point2i >& contourPoints );
+traceContourPavlidis( const EdgeBitmap& edges, const cv::Point2i& startPoint );
 
-cv::Mat thinning( const cv::Mat& imageIn );
+void sobelNonMaximumSuppressionTiled( const cv::Mat& imageIn,
+                                      int32_t blurSize, int32_t apertureSize,
+                                      double lowThreshold, double highThreshold,
+                                      GradientPlanes& planes,
+                                      const EdgeDetectionOptions& options );
 
-int32_t thinningIteration( cv::Mat& imageA, cv::Mat& imageB,
-                           const int32_t iteration );
+void nonMaximumSuppressionTiled( const cv::Mat& derivativeX,
+                                 const cv::Mat& derivativeY,
+                                 double lowThreshold, double highThreshold,
+                                 GradientPlanes& planes,
+                                 const EdgeDetectionOptions& options );
 
-void magnitudeNeighbourhood( const cv::Mat& derivationX,
-                             const cv::Mat& derivationY,
+void magnitudeNeighbourhood( const cv::Mat& magnitude,
                              const cv::Point2i& position,
                              const Neighbourhood& neighbourhood,
-                             std::vector< float >& magnitudes );
+                             std::array< float, 9 >& magnitudes );
+
+float derivativeValue( const cv::Mat& derivation, const cv::Point2i& position );
+
+void secondFacetModel( const std::array< float, 9 >& magnitudes,
+                       std::array< float, 6 >& facetModel );
 
-float amplitude( const cv::Mat& derivationX, const cv::Mat& derivationY,
-                 const cv::Point2i& position );
+inline void extractSubPixelPositionSecondFacet(
+    const cv::Point& pos, const cv::Mat& derivativeX,
+    const cv::Mat& derivativeY, const cv::Mat& magnitude,
+    cv::Point2f& subPixelPoint, float& response, cv::Point2f& direction );
 
-void secondFacetModel( const std::vector< float >& magnitudes,
-                       std::vector< float >& secondFacetModel );
+inline void extractSubPixelPositionFacetPlanes(
+    const FacetPlanes& facetPlanes, const cv::Point& pos,
+    const cv::Mat& derivativeX, const cv::Mat& derivativeY,
+    cv::Point2f& subPixelPoint, float& response, cv::Point2f& direction );
 
-void extractSubPixelPosition( const cv::Mat& image, const cv::Point& pos,
-                              const cv::Mat& derivativeX,
-                              const cv::Mat& derivativeY,
+inline void solveSecondFacet( const std::array< float, 6 >& facetModel,
+                              const cv::Point& pos,
+                              const cv::Point2f& gradient,
                               cv::Point2f& subPixelPoint, float& response,
                               cv::Point2f& direction );
 
-void extractSubPixelPositionSecondFacet(
-    const cv::Mat& image, const cv::Point& pos, const cv::Mat& derivativeX,
-    const cv::Mat& derivativeY, cv::Point2f& subPixelPoint, float& response,
-    cv::Point2f& direction );
+inline void extractSubPixelPositionDevernay(
+    const cv::Point& pos, const cv::Mat& derivativeX,
+    const cv::Mat& derivativeY, const cv::Mat& magnitude,
+    cv::Point2f& subPixelPoint, float& response, cv::Point2f& direction );
 
-void extractSubPixelPositionInterpolation(
-    const cv::Mat& image, const cv::Point& pos, const cv::Mat& derivativeX,
-    const cv::Mat& derivativeY, cv::Point2f& subPixelPoint, float& response,
-    cv::Point2f& direction );
+inline float bilinearValue( const cv::Mat& image, float x, float y );
 
-void calculateEigenValuesVectors( const cv::Mat& src, float& eigenValue1,
-                                  float& eigenValue2, cv::Point2f& eigenVector1,
-                                  cv::Point2f& eigenVector2 );
+inline void calculateEigenValuesVectorsSymmetric( float fxx, float fxy,
+                                                  float fyy, float& eigenValue1,
+                                                  float& eigenValue2,
+                                                  cv::Point2f& eigenVector1,
+                                                  cv::Point2f& eigenVector2 );
 
-void calculateEigenValuesVectorsCv( const cv::Mat& src, float& eigenValue1,
-                                    float& eigenValue2,
-                                    cv::Point2f& eigenVector1,
-                                    cv::Point2f& eigenVector2 );
+/*
+ * The subpixel extractors. Each one calculates the subpixel position, the
+ * response and the direction of one edge pixel. extractContourPoints is
+ * instantiated per extractor, so the extractor is inlined into the loop over
+ * the points and selecting it costs one branch per frame, not per point.
+ */
+struct InterpolationExtractor
+{
+    const GradientPlanes& planes;
+};
 
-void calculateEigenValuesVectorsSelf( const cv::Mat& src, float& eigenValue1,
-                                      float& eigenValue2,
-                                      cv::Point2f& eigenVector1,
-                                      cv::Point2f& eigenVector2 );
+struct SecondFacetExtractor
+{
+    const GradientPlanes& planes;
 
-void imageNeighbourhood( const cv::Mat& image, const cv::Point2i& position,
-                         const Neighbourhood& neighbourhood,
-                         std::vector< float >& magnitudes );
+    void operator( )( const cv::Point2i& pos, cv::Point2f& subPixelPoint,
+                      float& response, cv::Point2f& direction ) const
+    {
+        extractSubPixelPositionSecondFacet( pos,
+                                            planes.derivativeX,
+                                            planes.derivativeY,
+                                            planes.magnitude,
+                                            subPixelPoint,
+                                            response,
+                                            direction );
+    }
+};
 
-float pixelValue( const cv::Mat& image, const cv::Point2i& position );
+struct FacetPlanesExtractor
+{
+    const FacetPlanes& facetPlanes;
+    const GradientPlanes& planes;
+
+    void operator( )( const cv::Point2i& pos, cv::Point2f& subPixelPoint,
+                      float& response, cv::Point2f& direction ) const
+    {
+        extractSubPixelPositionFacetPlanes( facetPlanes,
+                                            pos,
+                                            planes.derivativeX,
+                                            planes.derivativeY,
+                                            subPixelPoint,
+                                            response,
+                                            direction );
+    }
+};
+
+struct DevernayExtractor
+{
+    const GradientPlanes& planes;
+
+    void operator( )( const cv::Point2i& pos, cv::Point2f& subPixelPoint,
+                      float& response, cv::Point2f& direction ) const
+    {
+        extractSubPixelPositionDevernay( pos,
+                                         planes.derivativeX,
+                                         planes.derivativeY,
+                                         planes.magnitude,
+                                         subPixelPoint,
+                                         response,
+                                         direction );
+    }
+};
+
+/*
+ * Function that calculates the subpixel positions of a list of points with
+ * the given extractor and appends them to the contour set, the offsets are
+ * not touched.
+ *
+ * @param [in]  extractor       The subpixel extractor
+ * @param [in]  points          The edge pixels
+ * @param [in]  numberPoints    The number of edge pixels
+ * @param [out] contours        The contour set receiving the results
+ * @param [in]  threadPool      Optional thread pool
+ */
+template < typename Extractor >
+void extractContourPoints( const Extractor& extractor,
+                           const cv::Point2i* points, size_t numberPoints,
+                           ContourSet& contours, ThreadPool* threadPool )
+{
+    const auto first = contours.x.size( );
+    contours.x.resize( first + numberPoints );
+    contours.y.resize( first + numberPoints );
+    contours.response.resize( first + numberPoints );
+    contours.directionX.resize( first + numberPoints );
+    contours.directionY.resize( first + numberPoints );
+
+    // Every point has its own output slot, the chunks write disjoint ranges
+    parallelFor( threadPool,
+                 0,
+                 static_cast< int32_t >( numberPoints ),
+                 kPointStripe,
+                 [ & ]( int32_t begin, int32_t end )
+                 {
+                     cv::Point2f subPixelPoint;
+                     cv::Point2f direction;
+
+                     for ( auto i = static_cast< size_t >( begin );
+                           i < static_cast< size_t >( end );
+                           i++ )
+                     {
+                         const auto out = first + i;
+
+                         extractor( points[ i ],
+                                    subPixelPoint,
+                                    contours.response[ out ],
+                                    direction );
+
+                         contours.x[ out ] = subPixelPoint.x;
+                         contours.y[ out ] = subPixelPoint.y;
+                         contours.directionX[ out ] = direction.x;
+                         contours.directionY[ out ] = direction.y;
+                     }
+                 } );
+}
+
+// The interpolation has its own batched loop
+void extractContourPoints( const InterpolationExtractor& extractor,
+                           const cv::Point2i* points, size_t numberPoints,
+                           ContourSet& contours, ThreadPool* threadPool )
+{
+    extractSubPixelPositions(
+        extractor.planes, points, numberPoints, contours, threadPool );
+}
 
 ///
 ///
 ///
 
+/*
+ * Function that calls a function for every tile of a frame on the thread
+ * pool. The tiles are extended by the halo on every side and clipped to the
+ * frame, so only the frame border is extended by the filters.
+ *
+ * @param [in]  size            The frame size
+ * @param [in]  tileSize        The edge length of the tiles
+ * @param [in]  halo            The width of the halo
+ * @param [in]  threadPool      The thread pool or nullptr
+ * @param [in]  tileFunction    Callable taking the tile, the extended tile and
+ *                              the tile inside the extended tile
+ */
+template < typename TileFunction >
+void forEachTile( const cv::Size& size, int32_t tileSize, int32_t halo,
+                  ThreadPool* threadPool, TileFunction&& tileFunction )
+{
+    const auto tilesX = ( size.width + tileSize - 1 ) / tileSize;
+    const auto tilesY = ( size.height + tileSize - 1 ) / tileSize;
+    const auto frame = cv::Rect( 0, 0, size.width, size.height );
+
+    parallelFor( threadPool,
+                 0,
+                 tilesX * tilesY,
+                 1,
+                 [ & ]( int32_t t0, int32_t t1 )
+                 {
+                     for ( auto t = t0; t < t1; t++ )
+                     {
+                         const auto tile =
+                             cv::Rect( ( t % tilesX ) * tileSize,
+                                       ( t / tilesX ) * tileSize,
+                                       tileSize,
+                                       tileSize ) &
+                             frame;
+                         const auto extended =
+                             cv::Rect( tile.x - halo,
+                                       tile.y - halo,
+                                       tile.width + 2 * halo,
+                                       tile.height + 2 * halo ) &
+                             frame;
+
+                         tileFunction( tile,
+                                       extended,
+                                       cv::Rect( tile.x - extended.x,
+                                                 tile.y - extended.y,
+                                                 tile.width,
+                                                 tile.height ) );
+                     }
+                 } );
+}
+
+// Copies the suppression planes of a tile center into the frame planes
+void copyTileCenter( const GradientPlanes& tilePlanes, const cv::Rect& center,
+                     const cv::Rect& tile, GradientPlanes& planes )
+{
+    tilePlanes.magnitude( center ).copyTo( planes.magnitude( tile ) );
+    tilePlanes.direction( center ).copyTo( planes.direction( tile ) );
+    tilePlanes.edgeClasses( center ).copyTo( planes.edgeClasses( tile ) );
+}
+
 std::vector< Contour > edgesSubPix( const cv::Mat& imageIn, int32_t blurSize,
                                     double alpha, int32_t edgeDetector,
                                     int32_t derivativeSize, double lowThreshold,
-                                    double highThreshold )
+                                    double highThreshold,
+                                    const EdgeDetectionOptions& options )
+{
+    ContourSet contourSet;
+    edgesSubPix( imageIn,
+                 blurSize,
+                 alpha,
+                 edgeDetector,
+                 derivativeSize,
+                 lowThreshold,
+                 highThreshold,
+                 contourSet,
+                 options );
+
+    std::vector< Contour > subPixelContours( contourSet.size( ) );
+
+    for ( size_t i = 0; i < contourSet.size( ); i++ )
+    {
+        auto& current = subPixelContours[ i ];
+        const auto begin = contourSet.offsets[ i ];
+        const auto end = contourSet.offsets[ i + 1 ];
+
+        current.subPixContour.reserve( end - begin );
+        current.response.reserve( end - begin );
+        current.direction.reserve( end - begin );
+
+        for ( auto j = begin; j < end; j++ )
+        {
+            current.subPixContour.emplace_back( contourSet.x[ j ],
+                                                contourSet.y[ j ] );
+            current.response.emplace_back( contourSet.response[ j ] );
+            current.direction.emplace_back( contourSet.directionX[ j ],
+                                            contourSet.directionY[ j ] );
+        }
+    }
+
+    return subPixelContours;
+}
+
+void edgesSubPix( const cv::Mat& imageIn, int32_t blurSize, double alpha,
+                  int32_t edgeDetector, int32_t derivativeSize,
+                  double lowThreshold, double highThreshold,
+                  ContourSet& contours, const EdgeDetectionOptions& options )
 {
+    contours.clear( );
+
+    // The scratch memory of the contour stages comes from the arena, the
+    // previous frame is not needed anymore
+    auto resource = std::pmr::get_default_resource( );
+    if ( options.arena != nullptr )
+    {
+        options.arena->reset( );
+        resource = options.arena->resource( );
+    }
+
+    // With tiles the local stages run tile by tile. The Gaussian blur is
+    // local and runs in the tiles of the Sobel detector. The recursive blur
+    // and the Deriche filter have an unbounded support, they run over the
+    // whole frame and only the suppression is tiled.
+    const auto tiled = options.tileSize > 0;
+    const auto blurInTiles = tiled && edgeDetector == 0 && blurSize > 0 &&
+                             options.blurMethod == BlurMethod::Gaussian;
+
     // First we need to blur the image with a gaussian
     cv::Mat imageBlurred;
-    if ( blurSize > 0 )
+    if ( blurInTiles )
+    {
+        // Blurred by the tiles
+    }
+    else if ( blurSize > 0 && options.blurMethod == BlurMethod::Recursive )
+    {
+        recursiveGaussianBlur( imageIn,
+                               imageBlurred,
+                               gaussianSigma( 2 * blurSize + 1 ),
+                               options.threadPool );
+    }
+    else if ( blurSize > 0 )
     {
         cv::GaussianBlur( imageIn,
                           imageBlurred,
@@ -179,308 +431,510 @@ std::vector< Contour > edgesSubPix( const cv::Mat& imageIn, int32_t blurSize,
     }
 
     // Since we want to calculate subpixel edges, the derivatives are required.
-    // We calculated them here and pass them to the canny operator that they are
-    // not calculated twice.
-    cv::Mat derivativeX;
-    cv::Mat derivativeY;
+    // They are calculated together with the magnitude and the non maximum
+    // suppression, the planes are kept for the subpixel stage.
+    GradientPlanes planes;
 
-    if ( edgeDetector == 0 )
+    if ( edgeDetector == 0 && tiled )
+    {
+        sobelNonMaximumSuppressionTiled( blurInTiles ? imageIn : imageBlurred,
+                                         blurInTiles ? blurSize : 0,
+                                         derivativeSize,
+                                         lowThreshold,
+                                         highThreshold,
+                                         planes,
+                                         options );
+    }
+    else if ( edgeDetector == 0 )
     {
-        cv::Sobel( imageBlurred, derivativeX, CV_16SC1, 1, 0, derivativeSize );
-        cv::Sobel( imageBlurred, derivativeY, CV_16SC1, 0, 1, derivativeSize );
+        sobelNonMaximumSuppression( imageBlurred,
+                                    derivativeSize,
+                                    lowThreshold,
+                                    highThreshold,
+                                    planes,
+                                    options.magnitudeType,
+                                    options.threadPool );
     }
     else
     {
-        const auto omega = alpha / 1000;
-        dericheX( imageBlurred, derivativeX, alpha, omega );
-        dericheY( imageBlurred, derivativeY, alpha, omega );
-        derivativeX.convertTo( derivativeX, CV_16SC1 );
-        derivativeY.convertTo( derivativeY, CV_16SC1 );
+        // The coefficients are cached, only a new alpha computes them. The
+        // derivatives stay float, all following stages accept CV_32F.
+        cv::Mat derivativeX;
+        cv::Mat derivativeY;
+        const auto coeff = getDericheCoefficients( alpha, alpha / 1000 );
+        dericheXY( imageBlurred,
+                   derivativeX,
+                   derivativeY,
+                   coeff,
+                   CV_32F,
+                   options.threadPool );
+
+        if ( tiled )
+        {
+            nonMaximumSuppressionTiled( derivativeX,
+                                        derivativeY,
+                                        lowThreshold,
+                                        highThreshold,
+                                        planes,
+                                        options );
+        }
+        else
+        {
+            nonMaximumSuppression( derivativeX,
+                                   derivativeY,
+                                   lowThreshold,
+                                   highThreshold,
+                                   planes,
+                                   options.magnitudeType,
+                                   options.threadPool );
+        }
     }
 
-    // Calculate canny edges bases on the derivatives
-    // Apply canny to get the edges
+    // Connect the weak edges to the strong ones. Unlike cv::Canny the result
+    // is one pixel wide, the binary stages work on it bit packed.
+    EdgeBitmap edgeMap( resource );
+    hysteresis( planes.edgeClasses, edgeMap );
+
     cv::Mat imageCanny;
-    cv::Canny(
-        derivativeX, derivativeY, imageCanny, lowThreshold, highThreshold );
+    edgeMap.copyTo( imageCanny );
 
-    // Note: The Canny image is not everywhere 1 pixel, we might run a thinning
-    // on the edge image.
-    imageCanny = thinning( imageCanny );
+    // The facet coefficients of the edge rows in one pass, the subpixel stage
+    // only loads them
+    FacetPlanes facetPlanes;
+    const auto useFacetPlanes =
+        options.subPixelMethod == SubPixelMethod::SecondFacet &&
+        options.denseFacetPlanes;
+
+    if ( useFacetPlanes )
+    {
+        computeFacetPlanes(
+            planes.magnitude, imageCanny, facetPlanes, options.threadPool );
+    }
+
+    // Calculates the subpixel positions of the ordered points. The extractor
+    // is selected once, the loop over the points is instantiated per
+    // extractor.
+    const auto extractPoints =
+        [ & ]( const cv::Point2i* points, size_t numberPoints )
+    {
+        switch ( options.subPixelMethod )
+        {
+        case SubPixelMethod::Interpolation:
+        {
+            extractContourPoints( InterpolationExtractor { planes },
+                                  points,
+                                  numberPoints,
+                                  contours,
+                                  options.threadPool );
+            break;
+        }
+
+        case SubPixelMethod::SecondFacet:
+        {
+            if ( useFacetPlanes )
+            {
+                extractContourPoints(
+                    FacetPlanesExtractor { facetPlanes, planes },
+                    points,
+                    numberPoints,
+                    contours,
+                    options.threadPool );
+            }
+            else
+            {
+                extractContourPoints( SecondFacetExtractor { planes },
+                                      points,
+                                      numberPoints,
+                                      contours,
+                                      options.threadPool );
+            }
+            break;
+        }
+
+        case SubPixelMethod::Devernay:
+        {
+            extractContourPoints( DevernayExtractor { planes },
+                                  points,
+                                  numberPoints,
+                                  contours,
+                                  options.threadPool );
+            break;
+        }
+        }
+    };
+
+    if ( options.contourOrdering == ContourOrdering::ChainLinking )
+    {
+        // One pass over the edge pixels gives ordered chains between
+        // endpoints and junctions, and the closed loops.
+        EdgeChains chains;
+        linkEdgeChains( imageCanny, chains, resource );
+
+        extractPoints( chains.points.data( ), chains.points.size( ) );
+        contours.offsets.assign( chains.offsets.begin( ),
+                                 chains.offsets.end( ) );
+
+        return;
+    }
 
     // To b able to get sub pixel contours, connected components needs to be
     // labeled. Why not using cv::findContours? The contours returned by
     // cv::findContours are always closed. Means a 1 Pixel line is represented
     // as a rectangular, having the points twice in the contour.
-    const auto contoursPix = labelContours( imageCanny );
+    std::pmr::vector< cv::Point2i > componentPoints( resource );
+    std::pmr::vector< size_t > componentOffsets( resource );
+    labelContours( edgeMap, componentPoints, componentOffsets );
 
-    // Now that we've found the pixel precise contour points, we can calculate
-    // the subpixel position for each point.
-    std::vector< Contour > subPixelContours;
+    // Now that we've found the pixel precise contour points, we can order
+    // them and calculate the subpixel position for each point.
+    std::vector< cv::Point2i > currentContour;
+    std::pmr::vector< cv::Point2i > orderedPoints( resource );
 
-    for ( auto& currentContour : contoursPix )
+    // Maps a pixel to its index in the current contour. It is shared by all
+    // contours and reset after each one, so building a graph is linear in the
+    // number of contour points.
+    cv::Mat indexImage( imageCanny.size( ), CV_32SC1, cv::Scalar::all( -1 ) );
+
+    for ( size_t i = 0; i + 1 < componentOffsets.size( ); i++ )
     {
+        currentContour.assign(
+            componentPoints.begin( ) +
+                static_cast< std::ptrdiff_t >( componentOffsets[ i ] ),
+            componentPoints.begin( ) +
+                static_cast< std::ptrdiff_t >( componentOffsets[ i + 1 ] ) );
+
         // Note: the pixel precise contours are not ordered from start to end
         // right now. This is something that a caller would expect. A contour
         // should not consist out of unordered scattered points.
-        const auto sortedContours =
-            calculateShortestPathsDijkstra( currentContour, imageCanny );
+        const auto sortedContours = calculateShortestPathsDijkstra(
+            currentContour, edgeMap, indexImage, resource );
 
         // Since the contour could have multiple start points due to junctions,
-        // we might get multiple results for one contour. Calculate the subpixel
-        // position for each contour now.
+        // we might get multiple results for one contour.
         for ( const auto& sortedContour : sortedContours )
         {
-            Contour current;
-            current.subPixContour.reserve( sortedContour.size( ) );
-            current.response.reserve( sortedContour.size( ) );
-            current.direction.reserve( sortedContour.size( ) );
+            orderedPoints.insert( orderedPoints.end( ),
+                                  sortedContour.begin( ),
+                                  sortedContour.end( ) );
+            contours.offsets.push_back( orderedPoints.size( ) );
+        }
+    }
 
-            float resp;
-            cv::Point2f dir;
-            cv::Point2f subPixelPoint;
+    extractPoints( orderedPoints.data( ), orderedPoints.size( ) );
+}
 
-            for ( const auto& point : sortedContour )
+/*
+ * Function that runs the Gaussian blur, the Sobel derivatives and the non
+ * maximum suppression tile by tile on the thread pool. Each tile is extended
+ * by a halo covering the blur and the Sobel kernel plus the one pixel the
+ * suppression compares with, so the center of a tile sees the same values as
+ * the whole frame and the assembled planes equal the untiled ones.
+ *
+ * @param [in]  imageIn         The input image (CV_8UC1)
+ * @param [in]  blurSize        The blur radius, 0 disables the blur
+ * @param [in]  apertureSize    The Sobel aperture size, 1, 3, 5, 7 or -1
+ * @param [in]  lowThreshold    The low threshold
+ * @param [in]  highThreshold   The high threshold
+ * @param [out] planes          The gradient planes, derivatives CV_16SC1
+ * @param [in]  options         The pipeline options, tileSize > 0
+ */
+void sobelNonMaximumSuppressionTiled( const cv::Mat& imageIn,
+                                      int32_t blurSize, int32_t apertureSize,
+                                      double lowThreshold, double highThreshold,
+                                      GradientPlanes& planes,
+                                      const EdgeDetectionOptions& options )
+{
+    CV_Assert( imageIn.type( ) == CV_8UC1 );
+    CV_Assert( options.tileSize > 0 );
+
+    const auto size = imageIn.size( );
+    const auto halo = blurSize + std::max( 1, apertureSize / 2 ) + 1;
+
+    planes.derivativeX.create( size, CV_16SC1 );
+    planes.derivativeY.create( size, CV_16SC1 );
+    planes.magnitude.create( size, CV_32FC1 );
+    planes.direction.create( size, CV_8UC1 );
+    planes.edgeClasses.create( size, CV_8UC1 );
+
+    forEachTile(
+        size,
+        options.tileSize,
+        halo,
+        options.threadPool,
+        [ & ]( const cv::Rect& tile,
+               const cv::Rect& extended,
+               const cv::Rect& center )
+        {
+            cv::Mat tileBlurred;
+            if ( blurSize > 0 )
             {
-                extractSubPixelPosition( imageBlurred,
-                                         point,
-                                         derivativeX,
-                                         derivativeY,
-                                         subPixelPoint,
-                                         resp,
-                                         dir );
-
-                current.subPixContour.emplace_back( subPixelPoint );
-
-                current.response.emplace_back( resp );
-
-                current.direction.emplace_back( dir );
+                cv::GaussianBlur(
+                    imageIn( extended ),
+                    tileBlurred,
+                    cv::Size( 2 * blurSize + 1, 2 * blurSize + 1 ),
+                    0 );
+            }
+            else
+            {
+                tileBlurred = imageIn( extended );
             }
 
-            subPixelContours.push_back( current );
-        }
-    }
+            GradientPlanes tilePlanes;
+            sobelNonMaximumSuppression( tileBlurred,
+                                        apertureSize,
+                                        lowThreshold,
+                                        highThreshold,
+                                        tilePlanes,
+                                        options.magnitudeType );
+
+            tilePlanes.derivativeX( center ).copyTo(
+                planes.derivativeX( tile ) );
+            tilePlanes.derivativeY( center ).copyTo(
+                planes.derivativeY( tile ) );
+            copyTileCenter( tilePlanes, center, tile, planes );
+        } );
+}
 
-    return subPixelContours;
+/*
+ * Function that runs the non maximum suppression of frame wide derivatives
+ * tile by tile on the thread pool. The halo is the one pixel the suppression
+ * compares with, the assembled planes equal the untiled ones.
+ *
+ * @param [in]  derivativeX     The derivative in x direction
+ *                              (CV_16SC1, CV_32FC1)
+ * @param [in]  derivativeY     The derivative in y direction, same type
+ * @param [in]  lowThreshold    The low threshold
+ * @param [in]  highThreshold   The high threshold
+ * @param [out] planes          The gradient planes
+ * @param [in]  options         The pipeline options, tileSize > 0
+ */
+void nonMaximumSuppressionTiled( const cv::Mat& derivativeX,
+                                 const cv::Mat& derivativeY,
+                                 double lowThreshold, double highThreshold,
+                                 GradientPlanes& planes,
+                                 const EdgeDetectionOptions& options )
+{
+    CV_Assert( derivativeX.size( ) == derivativeY.size( ) );
+    CV_Assert( options.tileSize > 0 );
+
+    const auto size = derivativeX.size( );
+
+    planes.derivativeX = derivativeX;
+    planes.derivativeY = derivativeY;
+    planes.magnitude.create( size, CV_32FC1 );
+    planes.direction.create( size, CV_8UC1 );
+    planes.edgeClasses.create( size, CV_8UC1 );
+
+    forEachTile( size,
+                 options.tileSize,
+                 1,
+                 options.threadPool,
+                 [ & ]( const cv::Rect& tile,
+                        const cv::Rect& extended,
+                        const cv::Rect& center )
+                 {
+                     GradientPlanes tilePlanes;
+                     nonMaximumSuppression( derivativeX( extended ),
+                                            derivativeY( extended ),
+                                            lowThreshold,
+                                            highThreshold,
+                                            tilePlanes,
+                                            options.magnitudeType );
+
+                     copyTileCenter( tilePlanes, center, tile, planes );
+                 } );
 }
 
 /*
- * Function finds connected contours in a canny image using connected component
- *  analysis in 8 connected neighbourhood.
+ * Function finds connected contours in an edge bitmap using connected
+ * component analysis in 8 connected neighbourhood.
  *
+ * The provisional labels are merged with a union find structure, the root of
+ * a set is always its smallest label. The points of a set are kept as linked
+ * list in one point buffer, so a merge only links two lists. The components
+ * and their points are returned in the same order as the previous labeling
+ * that copied the point vectors on every merge.
  *
- * @param [in]  imageIn The input canny image
+ * Only the edge pixels of the bitmap are visited. The labels of the previous
+ * row are kept per edge pixel, so there is no label image. The points of
+ * contour i are [offsets[i], offsets[i + 1]). The scratch memory comes from
+ * the memory resource of points.
  *
- * @return Returns vector of contour points.
+ * @param [in]  edges   The edge bitmap
+ * @param [out] points  The points of all contours
+ * @param [out] offsets The start of every contour and the end of the last one
  */
-std::vector< std::vector< cv::Point2i > >
-labelContours( const cv::Mat& imageIn )
+void labelContours( const EdgeBitmap& edges,
+                    std::pmr::vector< cv::Point2i >& points,
+                    std::pmr::vector< size_t >& offsets )
 {
-    std::vector< std::shared_ptr< std::vector< cv::Point2i > > > objects;
-    std::vector< int32_t > activeLabels;
+    constexpr int32_t kEndOfList = -1;
+
+    const auto resource = points.get_allocator( ).resource( );
+
+    // Indexed by label, label 0 is the background
+    std::pmr::vector< int32_t > parents( 1, 0, resource );
+    std::pmr::vector< int32_t > heads( 1, kEndOfList, resource );
+    std::pmr::vector< int32_t > tails( 1, kEndOfList, resource );
+
+    // Indexed by point in order of the scan
+    std::pmr::vector< cv::Point2i > scanPoints( resource );
+    std::pmr::vector< int32_t > nextPoints( resource );
+
+    // The edge pixels of the previous and the current row with their labels
+    std::pmr::vector< int32_t > previousXs( resource );
+    std::pmr::vector< int32_t > previousLabels( resource );
+    std::pmr::vector< int32_t > currentXs( resource );
+    std::pmr::vector< int32_t > currentLabels( resource );
 
     int32_t labelNumber = 0;
-    std::vector< int32_t > neighbourhood( 4 );
 
-    cv::Mat imgLabels(
-        imageIn.rows, imageIn.cols, CV_32SC1, cv::Scalar::all( 0 ) );
+    // The labels of the neighbours already visited
+    //
+    // |1|2|3|
+    // |0|c|x|
+    std::array< int32_t, 4 > neighbourhood { };
 
-    for ( auto y = 0; y < imageIn.rows; y++ )
+    for ( auto y = 0; y < edges.rows( ); y++ )
     {
-        const auto rowPtrSrc = imageIn.ptr< uint8_t >( y );
-        const auto rowPtrLbl = imgLabels.ptr< int32_t >( y );
+        edges.edgePoints( y, currentXs );
+        currentLabels.clear( );
 
-        for ( auto x = 0; x < imageIn.cols; x++ )
-        {
-            if ( rowPtrSrc[ x ] != 0 )
-            {
-                int32_t currentLabelNumber;
-                checkNeighbourhood( x, y, imgLabels, neighbourhood );
+        // The first pixel of the previous row that can touch the current one
+        size_t above = 0;
 
-                const auto minLabel =
-                    smallestNeighbour( neighbourhood, activeLabels );
+        for ( const auto x : currentXs )
+        {
+            neighbourhood.fill( 0 );
 
-                if ( minLabel == 0 )
-                {
-                    currentLabelNumber = ++labelNumber;
-                    rowPtrLbl[ x ] = currentLabelNumber;
-                    createElement(
-                        x, y, objects, activeLabels, currentLabelNumber );
-                }
-                else
-                {
-                    currentLabelNumber = minLabel;
-                    rowPtrLbl[ x ] = currentLabelNumber;
-                    addElement( x, y, minLabel, objects );
+            if ( ! currentLabels.empty( ) &&
+                 currentXs[ currentLabels.size( ) - 1 ] == x - 1 )
+            {
+                neighbourhood[ 0 ] = currentLabels.back( );
+            }
 
-                    mergeElement(
-                        neighbourhood, minLabel, objects, activeLabels );
-                }
+            while ( above < previousXs.size( ) && previousXs[ above ] < x - 1 )
+            {
+                above++;
             }
-        }
-    }
 
-    std::vector< std::vector< cv::Point2i > > contours;
+            for ( auto i = above;
+                  i < previousXs.size( ) && previousXs[ i ] <= x + 1;
+                  i++ )
+            {
+                const auto column =
+                    static_cast< size_t >( previousXs[ i ] - x + 2 );
+                neighbourhood[ column ] = previousLabels[ i ];
+            }
 
-    for ( size_t i = 0; i < activeLabels.size( ); i++ )
-    {
-        if ( activeLabels[ i ] != static_cast< int32_t >( i ) + 1 )
-            continue;
+            // The smallest root of the neighbours becomes the root of all
+            for ( auto& elem : neighbourhood )
+            {
+                elem = findLabelRoot( parents, elem );
+            }
 
-        contours.push_back( *objects[ i ] );
-    }
+            int32_t minLabel = 0;
+            for ( const auto elem : neighbourhood )
+            {
+                if ( elem > 0 && ( minLabel == 0 || elem < minLabel ) )
+                {
+                    minLabel = elem;
+                }
+            }
 
-    return contours;
-}
+            if ( minLabel == 0 )
+            {
+                minLabel = ++labelNumber;
+                parents.push_back( minLabel );
+                heads.push_back( kEndOfList );
+                tails.push_back( kEndOfList );
+            }
 
-/*
- * Function that check the 8 connected neighbourhood for labeling
- *
- * |x|x|x|
- * |x|c|0|
- * |0|0|0|
- *
- * @param [in]       x              The current x position
- * @param [in]       y              The current y position
- * @param [in]       referenceTable The reference table containing already
- *                                  applied label numbers.
- * @param [in out]   neighbourhood  The vector receiving the neighbours.
- */
-void checkNeighbourhood( int32_t x, int32_t y, const cv::Mat& referenceTable,
-                         std::vector< int32_t >& neighbourhood )
-{
-    const auto top = y - 1 >= 0 ? y - 1 : y;
-    const auto left = x - 1 >= 0 ? x - 1 : x;
-    const auto right = x + 1 < referenceTable.cols ? x + 1 : x;
+            currentLabels.push_back( minLabel );
 
-    const auto yPtr = referenceTable.ptr< int32_t >( y );
-    const auto topPtr = referenceTable.ptr< int32_t >( top );
+            // Append the point to the list of its set
+            const auto pointIndex =
+                static_cast< int32_t >( scanPoints.size( ) );
+            const auto root = static_cast< size_t >( minLabel );
+            scanPoints.emplace_back( x, y );
+            nextPoints.push_back( kEndOfList );
 
-    neighbourhood[ 0 ] = yPtr[ left ];
-    neighbourhood[ 1 ] = topPtr[ left ];
-    neighbourhood[ 2 ] = topPtr[ x ];
-    neighbourhood[ 3 ] = topPtr[ right ];
-}
+            if ( heads[ root ] == kEndOfList )
+            {
+                heads[ root ] = pointIndex;
+            }
+            else
+            {
+                nextPoints[ static_cast< size_t >( tails[ root ] ) ] =
+                    pointIndex;
+            }
+            tails[ root ] = pointIndex;
 
-/*
- * Function that returns the smallest element that is nonzero
- *
- * |x|x|x|
- * |x|c|0|
- * |0|0|0|
- *
- * @param [in]   neighbourhood   The vector receiving the neighbours.
- *
- * @return Returns the smallest nonzero element if exists, else zero.
- */
-int32_t smallestNeighbour( const std::vector< int32_t >& neighbourhood,
-                           const std::vector< int32_t >& activeLabels )
-{
-    int32_t smallest = std::numeric_limits< int32_t >::max( );
+            // Link the lists of the other sets behind it
+            for ( const auto elem : neighbourhood )
+            {
+                const auto other = static_cast< size_t >( elem );
 
-    for ( const auto& elem : neighbourhood )
-    {
-        if ( elem > 0 )
-        {
-            const auto label =
-                activeLabels[ static_cast< size_t >( elem - 1 ) ];
+                if ( elem == 0 || elem == minLabel ||
+                     parents[ other ] != elem )
+                {
+                    continue;
+                }
 
-            if ( label < smallest )
-            {
-                smallest = label;
+                nextPoints[ static_cast< size_t >( tails[ root ] ) ] =
+                    heads[ other ];
+                tails[ root ] = tails[ other ];
+                parents[ other ] = minLabel;
             }
         }
-    }
-
-    return smallest == std::numeric_limits< int32_t >::max( ) ? 0 : smallest;
-}
 
-/*
- * Function that creates a new object list and updates the reference table
- *
- *
- * @param [in]       x              The x position of the current pixel
- * @param [in]       y              The y position of the current pixel
- * @param [in]       objects        The table of already created objects
- * @param [in out]   referenceTable The reference table.
- */
-void createElement(
-    int32_t x, int32_t y,
-    std::vector< std::shared_ptr< std::vector< cv::Point2i > > >& objects,
-    std::vector< int32_t >& activeLabels, int32_t labelNumber )
-{
-    objects.push_back( std::make_shared< std::vector< cv::Point2i > >( ) );
+        std::swap( previousXs, currentXs );
+        std::swap( previousLabels, currentLabels );
+    }
 
-    objects.back( )->emplace_back( x, y );
+    points.clear( );
+    points.reserve( scanPoints.size( ) );
+    offsets.assign( 1, 0 );
 
-    activeLabels.push_back( labelNumber );
-}
+    for ( size_t label = 1; label < parents.size( ); label++ )
+    {
+        if ( parents[ label ] != static_cast< int32_t >( label ) )
+            continue;
 
-/*
- * Function that adds a point to an existing object. NOTE that 0 is not a valid
- * label number. 0 means background.
- * The object is added to object at index labelNumber - 1
- *
+        for ( auto index = heads[ label ]; index != kEndOfList;
+              index = nextPoints[ static_cast< size_t >( index ) ] )
+        {
+            points.push_back( scanPoints[ static_cast< size_t >( index ) ] );
+        }
 
- * @param [in]       x              The x position of the current pixel
- * @param [in]       y              The y position of the current pixel
- * @param [in]       objects        The table of already created objects
- *
- */
-void addElement(
-    int32_t x, int32_t y, int32_t labelNumber,
-    const std::vector< std::shared_ptr< std::vector< cv::Point2i > > >&
-        objects )
-{
-    objects[ static_cast< size_t >( labelNumber - 1 ) ]->emplace_back( x, y );
+        offsets.push_back( points.size( ) );
+    }
 }
 
 /*
- * Function that merges elements together, if elements in the neighbourhood
- * have a different label number.
+ * Function that returns the root label of a set and compresses the path to it
  *
- * @param [in]    neighbourhood  The vector receiving the neighbours.
- * @param [in]    newLabelNumber The label number to merge to.
- * @param [in]    objects        The table of already created objects.
- * @param [in]    referenceTable The reference table.
+ * @param [in out]   parents    The parent of every label, 0 is the background
+ * @param [in]       label      The label to look up
  *
+ * @return Returns the root label, 0 for the background.
  */
-void mergeElement(
-    const std::vector< int32_t >& neighbourhood, int32_t newLabelNumber,
-    std::vector< std::shared_ptr< std::vector< cv::Point2i > > >& objects,
-    std::vector< int32_t >& activeLabels )
+int32_t findLabelRoot( std::pmr::vector< int32_t >& parents, int32_t label )
 {
-    for ( const auto& elem : neighbourhood )
+    auto root = label;
+    while ( parents[ static_cast< size_t >( root ) ] != root )
     {
-        if ( elem > 0 )
-        {
-            const auto old_l = static_cast< size_t >( elem - 1 );
-            const auto new_l = static_cast< size_t >( newLabelNumber - 1 );
-            // Get the real label number of the current object, it could already
-            // be merged
-            const auto realElemNum = activeLabels[ old_l ];
-
-            if ( realElemNum != newLabelNumber )
-            {
-                if ( objects[ old_l ] == objects[ new_l ] )
-                    continue;
-
-                objects[ new_l ]->insert( objects[ new_l ]->end( ),
-                                          objects[ old_l ]->begin( ),
-                                          objects[ old_l ]->end( ) );
+        root = parents[ static_cast< size_t >( root ) ];
+    }
 
-                // All active labels needs to be changed to the merged one
-                for ( size_t i = 0; i < activeLabels.size( ); i++ )
-                {
-                    if ( activeLabels[ i ] == realElemNum )
-                    {
-                        activeLabels[ i ] = newLabelNumber;
-                        objects[ i ] = objects[ new_l ];
-                    }
-                }
-            }
-        }
+    while ( parents[ static_cast< size_t >( label ) ] != root )
+    {
+        const auto next = parents[ static_cast< size_t >( label ) ];
+        parents[ static_cast< size_t >( label ) ] = root;
+        label = next;
     }
+
+    return root;
 }
 
 /*
@@ -494,38 +948,48 @@ void mergeElement(
  *
  * @returns The ordered contour points
  */
-std::vector< std::vector< cv::Point2i > > calculateShortestPathsDijkstra(
+std::pmr::vector< std::pmr::vector< cv::Point2i > >
+calculateShortestPathsDijkstra(
     const std::vector< cv::Point2i >& unorderedContourPoints,
-    const cv::Mat& imageCanny )
+    const EdgeBitmap& edges, cv::Mat& indexImage,
+    std::pmr::memory_resource* resource )
 {
     const auto startIndices =
-        findPossibleStartPoints( unorderedContourPoints, imageCanny );
+        findPossibleStartPoints( unorderedContourPoints, edges );
 
     // Set distance at start position to 0
     if ( ! startIndices.empty( ) )
     {
         // startIndex = startIndices[ 0 ];
 
-        const auto adjacencyGraph =
-            calculateAdjacencyMatrix( unorderedContourPoints );
+        Graph adjacencyGraph(
+            static_cast< int32_t >( unorderedContourPoints.size( ) ),
+            resource );
+        calculateAdjacencyMatrix(
+            unorderedContourPoints, indexImage, adjacencyGraph );
+
+        std::pmr::vector< std::pmr::vector< cv::Point2i > > contours(
+            startIndices.size( ) - 1, resource );
 
-        std::vector< std::vector< cv::Point2i > > contours(
-            startIndices.size( ) - 1 );
+        // One search from the first end point. Contour i runs from end point
+        // i to end point i + 1 through the shortest path tree, which is the
+        // shortest path between them unless the component has a cycle.
+        adjacencyGraph.shortestPath(
+            static_cast< int32_t >( startIndices[ 0 ] ) );
 
-        for ( size_t i = 0; i < startIndices.size( ) - 1; i++ )
+        std::pmr::vector< size_t > path( resource );
+
+        for ( size_t i = 0; i + 1 < startIndices.size( ); i++ )
         {
-            const auto startIndex = startIndices[ i ];
-            const auto destIndex = startIndices[ i + 1 ];
+            path.clear( );
+            adjacencyGraph.appendTreePath(
+                startIndices[ i ], startIndices[ i + 1 ], path );
 
-            adjacencyGraph->shortestPath(
-                static_cast< int32_t >( startIndex ) );
+            contours[ i ].reserve( path.size( ) );
 
-            // Get all results from start point to all possible end points
-            for ( const auto& orderedIdx :
-                  adjacencyGraph->getShortestPath( destIndex ) )
+            for ( const auto index : path )
             {
-                contours.at( i ).push_back(
-                    unorderedContourPoints.at( orderedIdx ) );
+                contours[ i ].push_back( unorderedContourPoints[ index ] );
             }
         }
 
@@ -534,7 +998,13 @@ std::vector< std::vector< cv::Point2i > > calculateShortestPathsDijkstra(
 
     // The object is closed. Start point is first point.
     // Run contour tracing algorithm to sort contour points.
-    return { traceContourPavlidis( imageCanny, unorderedContourPoints[ 0 ] ) };
+    const auto contour =
+        traceContourPavlidis( edges, unorderedContourPoints[ 0 ] );
+
+    std::pmr::vector< std::pmr::vector< cv::Point2i > > contours( resource );
+    contours.emplace_back( contour.begin( ), contour.end( ) );
+
+    return contours;
 }
 
 /*
@@ -550,7 +1020,7 @@ std::vector< std::vector< cv::Point2i > > calculateShortestPathsDijkstra(
  */
 std::vector< size_t >
 findPossibleStartPoints( const std::vector< cv::Point2i >& contourPoints,
-                         const cv::Mat& imageIn )
+                         const EdgeBitmap& edges )
 {
     // Check for multiple start points
     // 0 start points -> Contour is closed. Choose one
@@ -563,15 +1033,16 @@ findPossibleStartPoints( const std::vector< cv::Point2i >& contourPoints,
     for ( size_t i = 0; i < contourPoints.size( ); i++ )
     {
         const auto& point = contourPoints[ i ];
+        const auto neighbours = edges.neighbours( point.x, point.y );
 
         const auto neighboursTop =
-            countNeighbours( point, imageIn, SearchDirection::Top );
+            countNeighbours( neighbours, SearchDirection::Top );
         const auto neighboursRight =
-            countNeighbours( point, imageIn, SearchDirection::Right );
+            countNeighbours( neighbours, SearchDirection::Right );
         const auto neighboursBottom =
-            countNeighbours( point, imageIn, SearchDirection::Bottom );
+            countNeighbours( neighbours, SearchDirection::Bottom );
         const auto neighboursLeft =
-            countNeighbours( point, imageIn, SearchDirection::Left );
+            countNeighbours( neighbours, SearchDirection::Left );
 
         // If a point does not have neighbours in two connected directions, it
         // is considered to be a endpoint
@@ -583,8 +1054,8 @@ findPossibleStartPoints( const std::vector< cv::Point2i >& contourPoints,
         {
             // It could be only a start point, if we have max 1 neighbour is the
             // 4 connected neighborhood
-            if ( countNeighbours(
-                     point, imageIn, Neighbourhood::FourConnected ) <= 1 )
+            if ( countNeighbours( neighbours, Neighbourhood::FourConnected ) <=
+                 1 )
             {
                 startIndices.push_back( i );
             }
@@ -602,146 +1073,79 @@ findPossibleStartPoints( const std::vector< cv::Point2i >& contourPoints,
 /*
  * Function counts the neighbours of a current pixel
  *
- * @param [in]    pos       The current position to count for.
- * @param [in]    imageIn   The input image.
- * @param [in]    direction The direction to search for neighbours.
+ * @param [in]    neighbours    The packed neighbours, see
+ *                              EdgeBitmap::neighbours.
+ * @param [in]    direction     The direction to search for neighbours.
  *
  * @returns The number of neighbours
  *
  */
-int32_t countNeighbours( const cv::Point2i& pos, const cv::Mat& imageIn,
+int32_t countNeighbours( uint8_t neighbours,
                          const SearchDirection direction )
 {
-    // Check 8 connectivity clockwise
-    // |1|2|3|
-    // |0|c|4|
-    // |7|6|5|
-
-    const auto x = pos.x;
-    const auto y = pos.y;
-
-    int32_t neighbours = 0;
+    // Bits of the neighbours clockwise
+    // |7|0|1|
+    // |6|c|2|
+    // |5|4|3|
 
-    // TODO: Get and pass rowPtr
+    uint8_t mask { };
 
     switch ( direction )
     {
     case SearchDirection::Top:
-        neighbours +=
-            getPixelValue( imageIn, { x - 1, y - 1 } ) != 0 ? 1 : 0;       // 1
-        neighbours += getPixelValue( imageIn, { x, y - 1 } ) != 0 ? 1 : 0; // 2
-        neighbours +=
-            getPixelValue( imageIn, { x + 1, y - 1 } ) != 0 ? 1 : 0; // 3
+        mask = 0b1000'0011;
         break;
     case SearchDirection::Right:
-        neighbours +=
-            getPixelValue( imageIn, { x + 1, y - 1 } ) != 0 ? 1 : 0;       // 3
-        neighbours += getPixelValue( imageIn, { x + 1, y } ) != 0 ? 1 : 0; // 4
-        neighbours +=
-            getPixelValue( imageIn, { x + 1, y + 1 } ) != 0 ? 1 : 0; // 5
+        mask = 0b0000'1110;
         break;
     case SearchDirection::Bottom:
-        neighbours +=
-            getPixelValue( imageIn, { x + 1, y + 1 } ) != 0 ? 1 : 0;       // 5
-        neighbours += getPixelValue( imageIn, { x, y + 1 } ) != 0 ? 1 : 0; // 6
-        neighbours +=
-            getPixelValue( imageIn, { x - 1, y + 1 } ) != 0 ? 1 : 0; // 7
+        mask = 0b0011'1000;
         break;
     case SearchDirection::Left:
-        neighbours +=
-            getPixelValue( imageIn, { x - 1, y - 1 } ) != 0 ? 1 : 0;       // 1
-        neighbours += getPixelValue( imageIn, { x - 1, y } ) != 0 ? 1 : 0; // 0
-        neighbours +=
-            getPixelValue( imageIn, { x - 1, y + 1 } ) != 0 ? 1 : 0; // 7
+        mask = 0b1110'0000;
         break;
     }
 
-    return neighbours;
+    return static_cast< int32_t >(
+        std::bitset< 8 >( neighbours & mask ).count( ) );
 }
 
 /*
  * Function counts the neighbours of a current pixel using neighbourhood
  * specification.
  *
- * @param [in]    pos           The current position to count for.
- * @param [in]    imageIn       The input image.
+ * @param [in]    neighbours    The packed neighbours, see
+ *                              EdgeBitmap::neighbours.
  * @param [in]    neighbourhood The neighbourhood to use.
  *
  * @returns The number of neighbours
  *
  */
-int32_t countNeighbours( const cv::Point2i& pos, const cv::Mat& imageIn,
+int32_t countNeighbours( uint8_t neighbours,
                          const Neighbourhood neighbourhood )
 {
-    // Check 8 connectivity clockwise
-    // |1|2|3|
-    // |0|c|4|
-    // |7|6|5|
-
     // Check 4 connectivity clockwise
-    // |x|2|x|
-    // |0|c|4|
-    // |x|6|x|
+    // |x|0|x|
+    // |6|c|2|
+    // |x|4|x|
 
-    const auto x = pos.x;
-    const auto y = pos.y;
+    const uint8_t mask =
+        neighbourhood == Neighbourhood::FourConnected ? 0b0101'0101 : 0xff;
 
-    int32_t neighbours = 0;
-
-    if ( neighbourhood == Neighbourhood::FourConnected )
-    {
-        neighbours += getPixelValue( imageIn, { x - 1, y } ) != 0 ? 1 : 0; // 0
-        neighbours += getPixelValue( imageIn, { x, y - 1 } ) != 0 ? 1 : 0; // 2
-        neighbours += getPixelValue( imageIn, { x + 1, y } ) != 0 ? 1 : 0; // 4
-        neighbours += getPixelValue( imageIn, { x, y + 1 } ) != 0 ? 1 : 0; // 6
-    }
-    else
-    {
-        neighbours += getPixelValue( imageIn, { x - 1, y } ) != 0 ? 1 : 0; // 0
-        neighbours +=
-            getPixelValue( imageIn, { x - 1, y - 1 } ) != 0 ? 1 : 0;       // 1
-        neighbours += getPixelValue( imageIn, { x, y - 1 } ) != 0 ? 1 : 0; // 2
-        neighbours +=
-            getPixelValue( imageIn, { x + 1, y - 1 } ) != 0 ? 1 : 0;       // 3
-        neighbours += getPixelValue( imageIn, { x + 1, y } ) != 0 ? 1 : 0; // 4
-        neighbours +=
-            getPixelValue( imageIn, { x + 1, y + 1 } ) != 0 ? 1 : 0;       // 5
-        neighbours += getPixelValue( imageIn, { x, y + 1 } ) != 0 ? 1 : 0; // 6
-        neighbours +=
-            getPixelValue( imageIn, { x - 1, y + 1 } ) != 0 ? 1 : 0; // 7
-    }
-
-    return neighbours;
+    return static_cast< int32_t >(
+        std::bitset< 8 >( neighbours & mask ).count( ) );
 }
 
-/*
- * Function returns the current pixel value, while checking for a valid access.
- *
- * @param [in]    point     The position to get the value for.
- * @param [in]    mat       The input image.
- *
- * @returns The gray value. If not in range returns 0.
- *
- */
-uint8_t getPixelValue( const cv::Mat& mat, const cv::Point2i& point )
-{
-    return ( point.x >= 0 && point.x < mat.cols && point.y >= 0 &&
-             point.y < mat.rows )
-               //? mat.at< uint8_t >( point )
-               ? mat.ptr< uint8_t >( point.y )[ point.x ]
-               : static_cast< uint8_t >( 0 );
-};
-
 /*
  * Function traces a contour using Pavlidis algorithm.
  *
- * @param [in]    imageIn       The input image containing contours.
+ * @param [in]    edges         The edge bitmap containing contours.
  * @param [in]    startPoint    The start point of the contour.
  *
  * @returns The contour of the object.
  *
  */
-std::vector< cv::Point2i > traceContourPavlidis( const cv::Mat& imageIn,
+std::vector< cv::Point2i > traceContourPavlidis( const EdgeBitmap& edges,
                                                  const cv::Point2i& startPoint )
 {
     SearchDirection direction = SearchDirection::Top;
@@ -839,9 +1243,9 @@ std::vector< cv::Point2i > traceContourPavlidis( const cv::Mat& imageIn,
             break;
         }
 
-        const uint8_t p1 = getPixelValue( imageIn, P1 );
-        const uint8_t p2 = getPixelValue( imageIn, P2 );
-        const uint8_t p3 = getPixelValue( imageIn, P3 );
+        const bool p1 = edges.test( P1 );
+        const bool p2 = edges.test( P2 );
+        const bool p3 = edges.test( P3 );
 
         if ( p1 )
         {
@@ -878,271 +1282,101 @@ std::vector< cv::Point2i > traceContourPavlidis( const cv::Mat& imageIn,
 }
 
 /*
- * Function that calculates an adjacency matrix for a contour.
+ * Function that calculates an adjacency matrix for a contour. Instead of
+ * comparing all pairs of points, the neighbours of a point are looked up in an
+ * index image, which makes it linear in the number of points. The neighbours
+ * are added in ascending order, so the adjacency lists are the same as the
+ * ones of the pairwise comparison.
  *
- * @param [in]    contourPoints The contour point to calculate the matrix for.
- *
- * @returns A graph object.
+ * @param [in]     contourPoints The contour point to calculate the matrix for.
+ * @param [in,out] indexImage    Image (CV_32SC1) covering all contour points.
+ *                               It has to be -1 everywhere and is -1 again on
+ *                               return.
+ * @param [in,out] graph         The graph with one vertex per contour point
+ *                               receiving the edges
  *
  */
-std::unique_ptr< Graph >
-calculateAdjacencyMatrix( const std::vector< cv::Point2i >& contourPoints )
+void calculateAdjacencyMatrix( const std::vector< cv::Point2i >& contourPoints,
+                               cv::Mat& indexImage, Graph& graph )
 {
+    CV_Assert( indexImage.type( ) == CV_32SC1 );
+
     const auto numberVertices = contourPoints.size( );
 
-    auto graph =
-        std::make_unique< Graph >( static_cast< int32_t >( numberVertices ) );
+    // Every point has at most 8 neighbours, so at most 4 edges per point
+    graph.reserveEdges( 4 * numberVertices );
 
     for ( size_t u = 0; u < numberVertices; u++ )
     {
-        const auto& lhs = contourPoints[ u ];
-        const auto& lhsX = lhs.x;
-        const auto& lhsY = lhs.y;
-
-        for ( size_t v = u; v < numberVertices; v++ )
-        {
-            if ( u == v )
-                continue;
-
-            const auto& rhs = contourPoints[ v ];
-            const auto dx = std::abs( lhsX - rhs.x );
-            const auto dy = std::abs( lhsY - rhs.y );
-
-            if ( ( dx <= 1 && dy <= 1 ) )
-            {
-                graph->addEdge( static_cast< int32_t >( u ),
-                                static_cast< int32_t >( v ),
-                                dx + dy );
-            }
-        }
+        const auto& position = contourPoints[ u ];
+        indexImage.ptr< int32_t >( position.y )[ position.x ] =
+            static_cast< int32_t >( u );
     }
 
-    return graph;
-}
-
-/**
- * @brief This function performs a thinning on a region
- *
- * @param [in]   imageIn            The input single channel 8 bit image
- *
- *  @return The thinned output image
- *
- * The thinning algorithm is base on the paper from T.Y. Zhang and C.Y. Suen
- * form 1984 It describes a parallel approach to thin binary structures im
- * two sub-iterations The algorithm is considering the 8 neighbors tto the
- * current pixel location.
- *
- *         P9              P2              P3
- *   (y - 1, x - 1)    (y - 1, x)    (y - 1, x + 1)
- *
- *         P8              P1              P4
- *     (y, x - 1)        (y, x)        (y, x + 1)
- *
- *         P7              P6              P5
- *    (y + 1, x - 1)   (y + 1, x)    (y + 1, x + 1)
- *
- *    Consider: The algorithm is expecting a binary image [0 : 1]
- *
- *    B(P1) is the sum of nonzero neighbors of P1.
- *    B(P1) = P2 + P3 + P4 + P5 + P6 + P7 + P8 + P9)
- *
- *    A(P1) is the number of transitions from 0 to 1 in the following order
- *    P2 P3 P4 P5 P6 P7 P8 P9 P2
- *
- *    Steps Iteration 1 -> Conditions to satisfy
- *    2 <= B(P1) <= 6
- *    A(P1) == 1
- *    P2 * P4 * P6 == 0
- *    P4 * P6 * P8 == 0
- *
- *    Steps Iteration 2 -> Conditions to satisfy
- *    2 <= B(P1) <= 6
- *    A(P1) == 1
- *    P2 * P4 * P8 == 0
- *    P2 * P6 * P8 == 0
- *
- */
-cv::Mat thinning( const cv::Mat& imageIn )
-{
-    // let border be the same in all directions
-    constexpr int32_t border = 1;
-    // constructs a larger image to fit both the image and the border
-    cv::Mat workImageA( imageIn.rows + border * 2,
-                        imageIn.cols + border * 2,
-                        imageIn.depth( ) );
-
-    cv::copyMakeBorder( imageIn,
-                        workImageA,
-                        border,
-                        border,
-                        border,
-                        border,
-                        cv::BORDER_CONSTANT,
-                        cv::Scalar::all( 0 ) );
-
-    const auto outRect = cv::Rect( 1, 1, imageIn.cols, imageIn.rows );
-
-    int32_t changedPixels;
-
-    cv::Mat workImageB = workImageA.clone( );
-
-    do
-    {
-        changedPixels = thinningIteration( workImageA, workImageB, 0 );
-
-        workImageB.copyTo( workImageA );
-
-        changedPixels +=
-            thinningIteration( // NOLINT(readability-suspicious-call-argument)
-                workImageB,
-                workImageA,
-                1 );
-
-        workImageA.copyTo( workImageB );
-
-    } while ( changedPixels > 0 );
-
-    return { workImageA( outRect ) };
-}
-
-int32_t thinningIteration( cv::Mat& imageA, cv::Mat& imageB,
-                           const int32_t iteration )
-{
-    int32_t changedPixel { };
-
-    std::array< uint8_t, 9 > neighbors { };
-
-    auto getNeighbors =
-        [ &neighbors, &imageA ]( const int32_t x, const int32_t y )
-    {
-        const auto rowPtrYP1 = imageA.ptr< uint8_t >( y + 1 );
-        const auto rowPtrY = imageA.ptr< uint8_t >( y );
-        const auto rowPtrYM1 = imageA.ptr< uint8_t >( y - 1 );
-
-        constexpr auto lbl = uint8_t { 255 };
-
-        neighbors[ 0 ] =
-            rowPtrY[ x ] == lbl ? uint8_t { 1 } : uint8_t { 0 }; // P1
-
-        neighbors[ 1 ] =
-            rowPtrYM1[ x ] == lbl ? uint8_t { 1 } : uint8_t { 0 }; // P2
-
-        neighbors[ 2 ] =
-            rowPtrYM1[ x + 1 ] == lbl ? uint8_t { 1 } : uint8_t { 0 }; // P3
-
-        neighbors[ 3 ] =
-            rowPtrY[ x + 1 ] == lbl ? uint8_t { 1 } : uint8_t { 0 }; // P4
-
-        neighbors[ 4 ] =
-            rowPtrYP1[ x + 1 ] == lbl ? uint8_t { 1 } : uint8_t { 0 }; // P5
-
-        neighbors[ 5 ] =
-            rowPtrYP1[ x ] == lbl ? uint8_t { 1 } : uint8_t { 0 }; // P6
-
-        neighbors[ 6 ] =
-            rowPtrYP1[ x - 1 ] == lbl ? uint8_t { 1 } : uint8_t { 0 }; // P7
-
-        neighbors[ 7 ] =
-            rowPtrY[ x - 1 ] == lbl ? uint8_t { 1 } : uint8_t { 0 }; // P8
-
-        neighbors[ 8 ] =
-            rowPtrYM1[ x - 1 ] == lbl ? uint8_t { 1 } : uint8_t { 0 }; // P9
-    };
+    std::array< int32_t, 8 > neighbours;
 
-    auto getTransitions = [ & ]( )
-    {
-        uint8_t transitions { };
-        // P2 P3 P4 P5 P6 P7 P8 P9 P2
-        transitions += neighbors[ 1 ] == 0 && neighbors[ 2 ] != 0; // P2 - P3
-        transitions += neighbors[ 2 ] == 0 && neighbors[ 3 ] != 0; // P3 - P4
-        transitions += neighbors[ 3 ] == 0 && neighbors[ 4 ] != 0; // P4 - P5
-        transitions += neighbors[ 4 ] == 0 && neighbors[ 5 ] != 0; // P5 - P6
-        transitions += neighbors[ 5 ] == 0 && neighbors[ 6 ] != 0; // P6 - P7
-        transitions += neighbors[ 6 ] == 0 && neighbors[ 7 ] != 0; // P7 - P8
-        transitions += neighbors[ 7 ] == 0 && neighbors[ 8 ] != 0; // P8 - P9
-        transitions += neighbors[ 8 ] == 0 && neighbors[ 1 ] != 0; // P9 - P2
-
-        return transitions;
-    };
-
-    auto sumNeighbors = [ & ]( )
+    for ( size_t u = 0; u < numberVertices; u++ )
     {
-        uint8_t sum { };
-        sum += neighbors[ 1 ];
-        sum += neighbors[ 2 ];
-        sum += neighbors[ 3 ];
-        sum += neighbors[ 4 ];
-        sum += neighbors[ 5 ];
-        sum += neighbors[ 6 ];
-        sum += neighbors[ 7 ];
-        sum += neighbors[ 8 ];
-        return sum;
-    };
+        const auto& lhs = contourPoints[ u ];
 
-    for ( int32_t y = 1; y < imageA.rows - 1; ++y )
-    {
-        const auto rowPtrSrcA = imageA.ptr< uint8_t >( y );
-        const auto rowPtrSrcB = imageB.ptr< uint8_t >( y );
+        // Only the neighbours behind u, the ones before already added the edge
+        size_t numberNeighbours = 0;
 
-        for ( int32_t x = 1; x < imageA.cols - 1; ++x )
+        for ( int32_t y = std::max( lhs.y - 1, 0 );
+              y <= std::min( lhs.y + 1, indexImage.rows - 1 );
+              y++ )
         {
-            if ( *( rowPtrSrcA + x ) != 0 )
+            const auto rowPtr = indexImage.ptr< int32_t >( y );
+
+            for ( int32_t x = std::max( lhs.x - 1, 0 );
+                  x <= std::min( lhs.x + 1, indexImage.cols - 1 );
+                  x++ )
             {
-                //  0  1  2  3  4  5  6  7  8
-                //  P1 P2 P3 P4 P5 P6 P7 P8 P9
-                getNeighbors( x, y );
-
-                const auto A = getTransitions( );
-
-                const auto B = sumNeighbors( );
-
-                const auto m1 = iteration == 0
-                                    ? static_cast< uint8_t >(
-                                          neighbors[ 1 ] * neighbors[ 3 ] *
-                                          neighbors[ 5 ] ) // P2 * P4 * P6
-                                    : static_cast< uint8_t >(
-                                          neighbors[ 1 ] * neighbors[ 3 ] *
-                                          neighbors[ 7 ] ); // P2 * P4 * P8
-                const auto m2 = iteration == 0
-                                    ? static_cast< uint8_t >(
-                                          neighbors[ 3 ] * neighbors[ 5 ] *
-                                          neighbors[ 7 ] ) // P4 * P6 * P8
-                                    : static_cast< uint8_t >(
-                                          neighbors[ 1 ] * neighbors[ 5 ] *
-                                          neighbors[ 7 ] ); // P2 * P6 * P8
-
-                if ( A == uint8_t { 1 } &&
-                     ( B >= uint8_t { 2 } && B <= uint8_t { 6 } ) &&
-                     m1 == uint8_t { 0 } && m2 == uint8_t { 0 } )
+                if ( rowPtr[ x ] > static_cast< int32_t >( u ) )
                 {
-                    changedPixel++;
-                    rowPtrSrcB[ x ] = uint8_t { 0 };
+                    neighbours[ numberNeighbours++ ] = rowPtr[ x ];
                 }
             }
         }
+
+        std::sort( neighbours.begin( ),
+                   neighbours.begin( ) +
+                       static_cast< std::ptrdiff_t >( numberNeighbours ) );
+
+        for ( size_t i = 0; i < numberNeighbours; i++ )
+        {
+            const auto& rhs =
+                contourPoints[ static_cast< size_t >( neighbours[ i ] ) ];
+            const auto dx = std::abs( lhs.x - rhs.x );
+            const auto dy = std::abs( lhs.y - rhs.y );
+
+            graph.addEdge(
+                static_cast< int32_t >( u ), neighbours[ i ], dx + dy );
+        }
     }
 
-    return changedPixel;
+    for ( const auto& point : contourPoints )
+    {
+        indexImage.ptr< int32_t >( point.y )[ point.x ] = -1;
+    }
 }
 
 /*
  * Function that returns the magnitude neighbourhood for a certain pixel
  *
- * @param [in]  derivationX     The derivative in x direction
- * @param [in]  derivationY     The derivative in y direction
+ * @param [in]  magnitude       The gradient magnitude plane (CV_32FC1)
  * @param [in]  position        The current position
  * @param [in]  neighbourhood   The neighbourhood to use
- * @param [in]  magnitudes      A vector receiving the results
+ * @param [in]  magnitudes      An array receiving the results
  *
  */
-void magnitudeNeighbourhood( const cv::Mat& derivationX,
-                             const cv::Mat& derivationY,
+void magnitudeNeighbourhood( const cv::Mat& magnitude,
                              const cv::Point2i& position,
                              const Neighbourhood& neighbourhood,
-                             std::vector< float >& magnitudes )
+                             std::array< float, 9 >& magnitudes )
 {
-    const auto imageWidth = derivationX.cols;
-    const auto imageHeight = derivationX.rows;
+    const auto imageWidth = magnitude.cols;
+    const auto imageHeight = magnitude.rows;
 
     const auto x = position.x;
     const auto y = position.y;
@@ -1152,233 +1386,223 @@ void magnitudeNeighbourhood( const cv::Mat& derivationX,
     const auto left = x - 1 >= 0 ? x - 1 : x;
     const auto right = x + 1 < imageWidth ? x + 1 : x;
 
+    const auto topPtr = magnitude.ptr< float >( top );
+    const auto centerPtr = magnitude.ptr< float >( y );
+    const auto downPtr = magnitude.ptr< float >( down );
+
     switch ( neighbourhood )
     {
     case Neighbourhood::FourConnected:
     {
-        magnitudes[ 0 ] =
-            amplitude( derivationX, derivationY, cv::Point2i( x, top ) );
-        magnitudes[ 1 ] =
-            amplitude( derivationX, derivationY, cv::Point2i( left, y ) );
-        magnitudes[ 2 ] =
-            amplitude( derivationX, derivationY, cv::Point2i( x, y ) );
-        magnitudes[ 3 ] =
-            amplitude( derivationX, derivationY, cv::Point2i( right, y ) );
-        magnitudes[ 4 ] =
-            amplitude( derivationX, derivationY, cv::Point2i( x, down ) );
+        magnitudes[ 0 ] = topPtr[ x ];
+        magnitudes[ 1 ] = centerPtr[ left ];
+        magnitudes[ 2 ] = centerPtr[ x ];
+        magnitudes[ 3 ] = centerPtr[ right ];
+        magnitudes[ 4 ] = downPtr[ x ];
         break;
     }
 
     case Neighbourhood::EightConnected:
     {
-        magnitudes[ 0 ] =
-            amplitude( derivationX, derivationY, cv::Point2i( left, top ) );
-        magnitudes[ 1 ] =
-            amplitude( derivationX, derivationY, cv::Point2i( x, top ) );
-        magnitudes[ 2 ] =
-            amplitude( derivationX, derivationY, cv::Point2i( right, top ) );
-        magnitudes[ 3 ] =
-            amplitude( derivationX, derivationY, cv::Point2i( left, y ) );
-        magnitudes[ 4 ] =
-            amplitude( derivationX, derivationY, cv::Point2i( x, y ) );
-        magnitudes[ 5 ] =
-            amplitude( derivationX, derivationY, cv::Point2i( right, y ) );
-        magnitudes[ 6 ] =
-            amplitude( derivationX, derivationY, cv::Point2i( left, down ) );
-        magnitudes[ 7 ] =
-            amplitude( derivationX, derivationY, cv::Point2i( x, down ) );
-        magnitudes[ 8 ] =
-            amplitude( derivationX, derivationY, cv::Point2i( right, down ) );
+        magnitudes[ 0 ] = topPtr[ left ];
+        magnitudes[ 1 ] = topPtr[ x ];
+        magnitudes[ 2 ] = topPtr[ right ];
+        magnitudes[ 3 ] = centerPtr[ left ];
+        magnitudes[ 4 ] = centerPtr[ x ];
+        magnitudes[ 5 ] = centerPtr[ right ];
+        magnitudes[ 6 ] = downPtr[ left ];
+        magnitudes[ 7 ] = downPtr[ x ];
+        magnitudes[ 8 ] = downPtr[ right ];
         break;
     }
     }
 }
 
 /*
- * Function that calculates the amplitude of an image at a certain position
+ * Function that returns the value of a derivative image at a certain position
  *
- * @param [in]  derivationX     The derivative in x direction
- * @param [in]  derivationY     The derivative in y direction
+ * @param [in]  derivation      The derivative (CV_16SC1 or CV_32FC1)
  * @param [in]  position        The current position
  *
  */
-float amplitude( const cv::Mat& derivationX, const cv::Mat& derivationY,
-                 const cv::Point2i& position )
+float derivativeValue( const cv::Mat& derivation, const cv::Point2i& position )
 {
-    const auto x = position.x;
-    const auto y = position.y;
-
-    const auto rowPtrX = derivationX.ptr< int16_t >( y );
-    const auto rowPtrY = derivationY.ptr< int16_t >( y );
+    if ( derivation.depth( ) == CV_32F )
+    {
+        return derivation.ptr< float >( position.y )[ position.x ];
+    }
 
-    return static_cast< float >( std::abs( rowPtrX[ x ] ) +
-                                 std::abs( rowPtrY[ x ] ) );
+    return static_cast< float >(
+        derivation.ptr< int16_t >( position.y )[ position.x ] );
 }
 
 /*
  * Function that calculates second facet model for a certain pixel based on the
- * magnitude neighbourhood.
+ * magnitude neighbourhood. The model is the least squares fit of
+ *
+ * f(x, y) = k0 + k1 * x + k2 * y + k3 * x^2 + k4 * x * y + k5 * y^2
+ *
+ * to the 3x3 neighbourhood, with x to the right and y down.
  *
- * @param [in]  magnitudes          The magnitudes for the pixel position
- * @param [in]  secondFacetModel    A vector receiving the second faced model.
+ * @param [in]  magnitudes  The magnitudes for the pixel position
+ * @param [out] facetModel  The coefficients k0 to k5
  *
  */
-void secondFacetModel( const std::vector< float >& magnitudes,
-                       std::vector< float >& secondFacetModel )
+void secondFacetModel( const std::array< float, 9 >& magnitudes,
+                       std::array< float, 6 >& facetModel )
 {
-    if ( secondFacetModel.size( ) != 6 && magnitudes.size( ) != 9 )
-    {
-        throw std::invalid_argument(
-            "The size of the incoming vector for the second "
-            "facet model or the magnitudes is wrong" );
-    }
+    const auto& m = magnitudes;
+
+    facetModel[ 0 ] = ( -m[ 0 ] + 2.0f * m[ 1 ] - m[ 2 ] + 2.0f * m[ 3 ] +
+                        5.0f * m[ 4 ] + 2.0f * m[ 5 ] - m[ 6 ] +
+                        2.0f * m[ 7 ] - m[ 8 ] ) /
+                      9.0f;
+
+    facetModel[ 1 ] =
+        ( -m[ 0 ] + m[ 2 ] - m[ 3 ] + m[ 5 ] - m[ 6 ] + m[ 8 ] ) / 6.0f;
+
+    facetModel[ 2 ] =
+        ( m[ 6 ] + m[ 7 ] + m[ 8 ] - m[ 0 ] - m[ 1 ] - m[ 2 ] ) / 6.0f;
+
+    facetModel[ 3 ] = ( m[ 0 ] - 2.0f * m[ 1 ] + m[ 2 ] + m[ 3 ] -
+                        2.0f * m[ 4 ] + m[ 5 ] + m[ 6 ] - 2.0f * m[ 7 ] +
+                        m[ 8 ] ) /
+                      6.0f;
 
-    secondFacetModel[ 0 ] = static_cast< float >(
-        ( magnitudes[ 0 ] + magnitudes[ 1 ] + magnitudes[ 2 ] +
-          magnitudes[ 3 ] + magnitudes[ 4 ] + magnitudes[ 5 ] +
-          magnitudes[ 6 ] + magnitudes[ 7 ] + magnitudes[ 8 ] ) /
-        9.0 );
-
-    secondFacetModel[ 1 ] = static_cast< float >(
-        ( -magnitudes[ 0 ] + magnitudes[ 2 ] - magnitudes[ 3 ] +
-          magnitudes[ 5 ] - magnitudes[ 6 ] + magnitudes[ 8 ] ) /
-        6.0 );
-
-    secondFacetModel[ 2 ] = static_cast< float >(
-        ( magnitudes[ 6 ] + magnitudes[ 7 ] + magnitudes[ 8 ] -
-          magnitudes[ 0 ] - magnitudes[ 1 ] - magnitudes[ 2 ] ) /
-        6.0 );
-
-    secondFacetModel[ 3 ] = static_cast< float >(
-        ( magnitudes[ 0 ] - 2.0 * magnitudes[ 1 ] + magnitudes[ 2 ] +
-          magnitudes[ 3 ] - 2.0 * magnitudes[ 4 ] + magnitudes[ 5 ] +
-          magnitudes[ 6 ] - 2.0 * magnitudes[ 7 ] + magnitudes[ 8 ] ) /
-        6.0 );
-
-    secondFacetModel[ 4 ] =
-        static_cast< float >( ( -magnitudes[ 0 ] + magnitudes[ 2 ] +
-                                magnitudes[ 6 ] - magnitudes[ 8 ] ) /
-                              4.0 );
-
-    secondFacetModel[ 5 ] = static_cast< float >(
-        ( magnitudes[ 0 ] + magnitudes[ 1 ] + magnitudes[ 2 ] -
-          2.0 * ( magnitudes[ 3 ] + magnitudes[ 4 ] + magnitudes[ 5 ] ) +
-          magnitudes[ 6 ] + magnitudes[ 7 ] + magnitudes[ 8 ] ) /
-        6.0 );
+    facetModel[ 4 ] = ( m[ 0 ] - m[ 2 ] - m[ 6 ] + m[ 8 ] ) / 4.0f;
+
+    facetModel[ 5 ] = ( m[ 0 ] + m[ 1 ] + m[ 2 ] -
+                        2.0f * ( m[ 3 ] + m[ 4 ] + m[ 5 ] ) + m[ 6 ] + m[ 7 ] +
+                        m[ 8 ] ) /
+                      6.0f;
 }
 
 /*
- * Function that calculates the sub pixel coordinate for a certain pixel using
- * interpolation along the gradient
+ * Function that calculates the sub pixel coordinate for a certain pixel as the
+ * ridge of the second facet model fitted to the magnitude. Everything stays on
+ * the stack, no allocation per point.
  *
- * @param [in]  image           The input image
  * @param [in]  pos             The current position
  * @param [in]  derivativeX     The derivative of the image in x direction
  * @param [in]  derivativeY     The derivative of the image in y direction
+ * @param [in]  magnitude       The gradient magnitude of the image
  * @param [in]  subPixelPoint   The calculated subpixel point
  * @param [in]  response        The calculated response
  * @param [in]  direction       The calculated direction
  *
  */
-void extractSubPixelPosition( const cv::Mat& image, const cv::Point& pos,
-                              const cv::Mat& derivativeX,
-                              const cv::Mat& derivativeY,
-                              cv::Point2f& subPixelPoint, float& response,
-                              cv::Point2f& direction )
+inline void extractSubPixelPositionSecondFacet(
+    const cv::Point& pos, const cv::Mat& derivativeX,
+    const cv::Mat& derivativeY, const cv::Mat& magnitude,
+    cv::Point2f& subPixelPoint, float& response, cv::Point2f& direction )
 {
-    /*extractSubPixelPositionSecondFacet( image,
-                                        pos,
-                                        derivativeX,
-                                        derivativeY,
-                                        subPixelPoint,
-                                        response,
-                                        direction );*/
-
-    extractSubPixelPositionInterpolation( image,
-                                          pos,
-                                          derivativeX,
-                                          derivativeY,
-                                          subPixelPoint,
-                                          response,
-                                          direction );
-}
+    std::array< float, 9 > magnitudes;
+    std::array< float, 6 > facetModel;
 
-void extractSubPixelPositionSecondFacet(
-    const cv::Mat& image, const cv::Point& pos, const cv::Mat& derivativeX,
-    const cv::Mat& derivativeY, cv::Point2f& subPixelPoint, float& response,
-    cv::Point2f& direction )
-{
-    std::vector< float > magnitudes( 9 );
-    std::vector< float > facetModel( 6 );
+    // The facet model is fitted to the precomputed magnitude plane, the edge
+    // is the ridge of the magnitude.
+    magnitudeNeighbourhood(
+        magnitude, pos, Neighbourhood::EightConnected, magnitudes );
 
-    /*magnitudeNeighbourhood( imageSobelX,
-                                        imageSobelY,
-                                        point,
-                                        Neighbourhood::EightConnected,
-                                        magnitudes );*/
+    secondFacetModel( magnitudes, facetModel );
 
-    imageNeighbourhood( image, pos, Neighbourhood::EightConnected, magnitudes );
+    const cv::Point2f gradient( derivativeValue( derivativeX, pos ),
+                                derivativeValue( derivativeY, pos ) );
 
-    secondFacetModel( magnitudes, facetModel );
+    solveSecondFacet(
+        facetModel, pos, gradient, subPixelPoint, response, direction );
+}
 
-    //     | a     b |
-    // H:= |         |
-    //     | c     d |
+/*
+ * Function that calculates the sub pixel coordinate for a certain pixel like
+ * extractSubPixelPositionSecondFacet, but loads the facet model from the
+ * precomputed planes.
+ *
+ * @param [in]  facetPlanes     The facet coefficient planes
+ * @param [in]  pos             The current position
+ * @param [in]  derivativeX     The derivative of the image in x direction
+ * @param [in]  derivativeY     The derivative of the image in y direction
+ * @param [in]  subPixelPoint   The calculated subpixel point
+ * @param [in]  response        The calculated response
+ * @param [in]  direction       The calculated direction
+ *
+ */
+inline void extractSubPixelPositionFacetPlanes(
+    const FacetPlanes& facetPlanes, const cv::Point& pos,
+    const cv::Mat& derivativeX, const cv::Mat& derivativeY,
+    cv::Point2f& subPixelPoint, float& response, cv::Point2f& direction )
+{
+    std::array< float, 6 > facetModel;
+    for ( size_t i = 0; i < facetModel.size( ); i++ )
+    {
+        facetModel[ i ] =
+            facetPlanes.coefficients[ i ].ptr< float >( pos.y )[ pos.x ];
+    }
 
-    //     | fxx fxy |
-    // H:= |         |
-    //     | fyx fyy |
+    const cv::Point2f gradient( derivativeValue( derivativeX, pos ),
+                                derivativeValue( derivativeY, pos ) );
 
-    // derivatives
-    // f    = fm[ 0 ]
-    // fx   = fm[ 1 ]
-    // fy   = fm[ 2 ]
-    // fxy  = fm[ 4 ]
-    // fxx  = fm[ 3 ]
-    // fyy  = fm[ 5 ]
+    solveSecondFacet(
+        facetModel, pos, gradient, subPixelPoint, response, direction );
+}
 
+/*
+ * Function that calculates the sub pixel point of a second facet model. The
+ * ridge normal is the eigenvector of the hessian with the largest absolute
+ * eigenvalue, the sub pixel point is the maximum of the model along it.
+ *
+ * @param [in]  facetModel      The coefficients k0 to k5 of the model
+ * @param [in]  pos             The current position
+ * @param [in]  gradient        The image gradient, orients the direction
+ * @param [out] subPixelPoint   The calculated subpixel point
+ * @param [out] response        The model value at the subpixel point
+ * @param [out] direction       The ridge normal
+ *
+ */
+inline void solveSecondFacet( const std::array< float, 6 >& facetModel,
+                              const cv::Point& pos,
+                              const cv::Point2f& gradient,
+                              cv::Point2f& subPixelPoint, float& response,
+                              cv::Point2f& direction )
+{
     const auto f = facetModel[ 0 ];
     const auto fx = facetModel[ 1 ];
     const auto fy = facetModel[ 2 ];
+
+    //     | fxx fxy |
+    // H:= |         |
+    //     | fxy fyy |
+    const auto fxx = 2.0f * facetModel[ 3 ];
     const auto fxy = facetModel[ 4 ];
-    const auto fxx = facetModel[ 3 ];
-    const auto fyy = facetModel[ 5 ];
-    std::ignore = f;
+    const auto fyy = 2.0f * facetModel[ 5 ];
 
     cv::Point2f eigenVector1;
     cv::Point2f eigenVector2;
     float eigenValue1 { };
     float eigenValue2 { };
 
-    cv::Mat H( 2, 2, CV_32FC1 );
-    H.at< float >( 0, 0 ) = fxx;
-    H.at< float >( 0, 1 ) = fxy;
-    H.at< float >( 1, 0 ) = fxy;
-    H.at< float >( 1, 1 ) = fyy;
+    calculateEigenValuesVectorsSymmetric(
+        fxx, fxy, fyy, eigenValue1, eigenValue2, eigenVector1, eigenVector2 );
 
-    calculateEigenValuesVectors(
-        H, eigenValue1, eigenValue2, eigenVector1, eigenVector2 );
+    auto normal = std::fabs( eigenValue1 ) >= std::fabs( eigenValue2 )
+                      ? eigenVector1
+                      : eigenVector2;
 
-    if ( eigenValue1 < eigenValue2 )
+    // The eigenvector has no sign, take the one of the image gradient
+    if ( normal.dot( gradient ) < 0.0f )
     {
-        std::cout << "Error\n";
+        normal = { -normal.x, -normal.y };
     }
 
-    const double nx = eigenVector1.x;
-    const double ny = eigenVector1.y;
-    /*response = std::abs( eigenValue1 );*/
-    /*response = std::abs( f );*/
-    response = std::sqrt( fx * fx + fy * fy );
-
-    // Having the highest eigenvalue and corresponding eigenvector defined on
-    // position 1 we can calculate the sub pixel offset described in the paper.
+    const auto nx = normal.x;
+    const auto ny = normal.y;
 
-    //                    rx * nx + ry * ny
+    //                    fx * nx + fy * ny
     // t = - -------------------------------------------
-    //       rxx * nx^2 + 2 * rxy * nx * ny + ryy * ny^2
+    //       fxx * nx^2 + 2 * fxy * nx * ny + fyy * ny^2
 
-    const auto divisor = fxx * nx * nx + 2.0 * fxy * nx * ny + fyy * ny * ny;
-    double t { };
+    const auto divisor = fxx * nx * nx + 2.0f * fxy * nx * ny + fyy * ny * ny;
+    float t { };
     if ( ! isZero( divisor ) )
     {
         t = -( fx * nx + fy * ny ) / divisor;
@@ -1387,117 +1611,71 @@ void extractSubPixelPositionSecondFacet(
     // Having t the sub pixel point is defined as:
     // (px, py) = (t * nx, t * ny)
     // And the rule for (px, py) ELEMENT [-0.5, 0.5] X [-0.5, 0.5]
-    double px = nx * t;
-    double py = ny * t;
+    auto px = nx * t;
+    auto py = ny * t;
 
-    if ( std::fabs( px ) > 0.5 )
+    if ( std::fabs( px ) > 0.5f )
     {
-        px = 0.0;
+        px = 0.0f;
     }
 
-    if ( std::fabs( py ) > 0.5 )
+    if ( std::fabs( py ) > 0.5f )
     {
-        py = 0.0;
+        py = 0.0f;
     }
 
-    auto x = static_cast< double >( pos.x );
-    auto y = static_cast< double >( pos.y );
+    subPixelPoint = { static_cast< float >( pos.x ) + px,
+                      static_cast< float >( pos.y ) + py };
 
-    x += px;
-    y += py;
+    response = f + fx * px + fy * py + facetModel[ 3 ] * px * px +
+               fxy * px * py + facetModel[ 5 ] * py * py;
 
-    subPixelPoint = { static_cast< float >( x ), static_cast< float >( y ) };
-
-    direction = { static_cast< float >( nx ), static_cast< float >( ny ) };
-    // const double a = std::atan2( y, x );
-    // direction = a >= 0.0 ? a : a + CV_2PI;
+    direction = normal;
 }
 
-void extractSubPixelPositionInterpolation(
-    const cv::Mat& image, const cv::Point& pos, const cv::Mat& derivativeX,
-    const cv::Mat& derivativeY, cv::Point2f& subPixelPoint, float& response,
-    cv::Point2f& direction )
+/*
+ * Function that calculates the sub pixel coordinate for a certain pixel as
+ * proposed by Devernay: "A non-maxima suppression method for edge detection
+ * with sub-pixel accuracy". Unlike the interpolation the neighbours are not
+ * quantized, the magnitude is sampled bilinearly one pixel along the gradient
+ * in both directions and the parabola vertex is taken along the gradient.
+ *
+ * @param [in]  pos             The current position
+ * @param [in]  derivativeX     The derivative of the image in x direction
+ * @param [in]  derivativeY     The derivative of the image in y direction
+ * @param [in]  magnitude       The gradient magnitude of the image
+ * @param [in]  subPixelPoint   The calculated subpixel point
+ * @param [in]  response        The calculated response
+ * @param [in]  direction       The calculated direction
+ *
+ */
+inline void extractSubPixelPositionDevernay(
+    const cv::Point& pos, const cv::Mat& derivativeX,
+    const cv::Mat& derivativeY, const cv::Mat& magnitude,
+    cv::Point2f& subPixelPoint, float& response, cv::Point2f& direction )
 {
-    const auto nx = static_cast< float >( derivativeX.at< int16_t >( pos ) );
-    const auto ny = static_cast< float >( derivativeY.at< int16_t >( pos ) );
-
-    direction = cv::Point2f( nx, ny );
-    direction = direction / cv::norm( direction );
+    const auto gx = derivativeValue( derivativeX, pos );
+    const auto gy = derivativeValue( derivativeY, pos );
+    const auto norm = std::sqrt( gx * gx + gy * gy );
 
-    auto dir = std::atan2( ny, nx ) * 180.0f / CV_PI + 180.0f;
+    const auto x = static_cast< float >( pos.x );
+    const auto y = static_cast< float >( pos.y );
 
-    constexpr std::array< int32_t, 4 > posXp { { 1, 1, 0, -1 } };
-    constexpr std::array< int32_t, 4 > posXm { { -1, -1, 0, 1 } };
+    response = magnitude.ptr< float >( pos.y )[ pos.x ];
 
-    constexpr std::array< int32_t, 4 > posYp { { 0, -1, -1, -1 } };
-    constexpr std::array< int32_t, 4 > posYm { { 0, 1, 1, 1 } };
-
-    auto d = [ &dir ]( )
+    if ( ! ( norm > 0.0f ) )
     {
-        if ( ( dir > 157.5 && dir <= 202.5 ) || dir <= 22.5 || dir > 337.5 )
-        {
-            return 0;
-        }
-
-        if ( ( dir > 22.5 && dir <= 67.5 ) || ( dir > 202.5 && dir <= 247.5 ) )
-        {
-            return 1;
-        }
-
-        if ( ( dir > 67.5 && dir <= 112.5 ) || ( dir > 247.5 && dir <= 292.5 ) )
-        {
-            return 2;
-        }
-
-        return 3;
-    };
-
-    const auto edgeDir = d( );
-
-    const auto x = pos.x;
-    const auto y = pos.y;
-
-    auto xp = x + posXp.at( edgeDir );
-    auto xm = x + posXm.at( edgeDir );
-
-    auto yp = y + posYp.at( edgeDir );
-    auto ym = y + posYm.at( edgeDir );
-
-    if ( xm < 0 )
-    {
-        xm = 0;
-    }
-
-    if ( xp >= derivativeX.cols )
-    {
-        xp = derivativeX.cols - 1;
-    }
-
-    if ( ym < 0 )
-    {
-        ym = 0;
-    }
-
-    if ( yp >= derivativeX.rows )
-    {
-        yp = derivativeX.rows - 1;
+        subPixelPoint = { x, y };
+        direction = { 0.0f, 0.0f };
+        return;
     }
 
-	if ( ym >= derivativeX.rows )
-    {
-        ym = derivativeX.rows - 1;
-    }
-
-    if ( yp < 0 )
-    {
-        yp = 0;
-    }
-
-    const auto Kp = amplitude( derivativeX, derivativeY, { xp, yp } );
-    const auto Km = amplitude( derivativeX, derivativeY, { xm, ym } );
-    const auto Ko = amplitude( derivativeX, derivativeY, { x, y } );
+    const auto nx = gx / norm;
+    const auto ny = gy / norm;
 
-    response = Ko;
+    const auto Kp = bilinearValue( magnitude, x + nx, y + ny );
+    const auto Km = bilinearValue( magnitude, x - nx, y - ny );
+    const auto Ko = response;
 
     //            Km - Kp
     // n = ------------------------
@@ -1511,55 +1689,217 @@ void extractSubPixelPositionInterpolation(
         n = 0.5f * top / bottom;
     }
 
-    if ( std::fabs( n ) > 0.5 )
+    if ( std::fabs( n ) > 0.5f )
     {
         n = 0.0f;
     }
 
-    subPixelPoint = cv::Point2f( static_cast< float >( x ) + n,
-                                 static_cast< float >( y ) + n );
+    subPixelPoint = { x + n * nx, y + n * ny };
+    direction = { nx, ny };
 }
 
-void calculateEigenValuesVectors( const cv::Mat& src, float& eigenValue1,
-                                  float& eigenValue2, cv::Point2f& eigenVector1,
-                                  cv::Point2f& eigenVector2 )
+/*
+ * Function that returns the bilinear interpolation of a float image, the
+ * borders are extended with the border pixel.
+ *
+ * @param [in]  image   The image (CV_32FC1)
+ * @param [in]  x       The x coordinate
+ * @param [in]  y       The y coordinate
+ *
+ */
+inline float bilinearValue( const cv::Mat& image, float x, float y )
 {
-    calculateEigenValuesVectorsCv(
-        src, eigenValue1, eigenValue2, eigenVector1, eigenVector2 );
+    const auto maxX = static_cast< float >( image.cols - 1 );
+    const auto maxY = static_cast< float >( image.rows - 1 );
+
+    x = std::clamp( x, 0.0f, maxX );
+    y = std::clamp( y, 0.0f, maxY );
+
+    const auto x0 = static_cast< int32_t >( x );
+    const auto y0 = static_cast< int32_t >( y );
+    const auto x1 = std::min( x0 + 1, image.cols - 1 );
+    const auto y1 = std::min( y0 + 1, image.rows - 1 );
+
+    const auto wx = x - static_cast< float >( x0 );
+    const auto wy = y - static_cast< float >( y0 );
+
+    const auto row0 = image.ptr< float >( y0 );
+    const auto row1 = image.ptr< float >( y1 );
+
+    const auto top = row0[ x0 ] + wx * ( row0[ x1 ] - row0[ x0 ] );
+    const auto bottom = row1[ x0 ] + wx * ( row1[ x1 ] - row1[ x0 ] );
 
-    /* calculateEigenValuesVectorsSelf(
-         src, eigenValue1, eigenValue2, eigenVector1, eigenVector2 );*/
+    return top + wy * ( bottom - top );
 }
 
-void calculateEigenValuesVectorsCv( const cv::Mat& src, float& eigenValue1,
-                                    float& eigenValue2,
-                                    cv::Point2f& eigenVector1,
-                                    cv::Point2f& eigenVector2 )
+/*
+ * Function that calculates the interpolation of the points [begin, end) of a
+ * block, see extractSubPixelPositions. The results are written to the output
+ * arrays starting at index 0.
+ */
+template < typename T >
+void interpolateSubPixelBlock( const GradientPlanes& planes,
+                               const cv::Point2i* points, size_t begin,
+                               size_t end, float* outX, float* outY,
+                               float* outResponse, float* outDirectionX,
+                               float* outDirectionY )
 {
-    cv::Mat eigenValues;
-    cv::Mat eigenVectors;
+    std::array< float, kInterpolationBlock > gx;
+    std::array< float, kInterpolationBlock > gy;
+    std::array< float, kInterpolationBlock > km;
+    std::array< float, kInterpolationBlock > ko;
+    std::array< float, kInterpolationBlock > kp;
+    std::array< float, kInterpolationBlock > px;
+    std::array< float, kInterpolationBlock > py;
+    std::array< float, kInterpolationBlock > sx;
+    std::array< float, kInterpolationBlock > sy;
+
+    const auto& magnitude = planes.magnitude;
+    const auto count = end - begin;
+
+    // Gather, the direction is the one quantized by the non maximum
+    // suppression
+    for ( size_t i = 0; i < count; i++ )
+    {
+        const auto& p = points[ begin + i ];
+        const auto edgeDir = planes.direction.ptr< uint8_t >( p.y )[ p.x ];
+        const auto stepX = kInterpolationStepX[ edgeDir ];
+        const auto stepY = kInterpolationStepY[ edgeDir ];
+
+        const auto xp = std::clamp( p.x + stepX, 0, magnitude.cols - 1 );
+        const auto xm = std::clamp( p.x - stepX, 0, magnitude.cols - 1 );
+        const auto yp = std::clamp( p.y + stepY, 0, magnitude.rows - 1 );
+        const auto ym = std::clamp( p.y - stepY, 0, magnitude.rows - 1 );
+
+        gx[ i ] = static_cast< float >(
+            planes.derivativeX.ptr< T >( p.y )[ p.x ] );
+        gy[ i ] = static_cast< float >(
+            planes.derivativeY.ptr< T >( p.y )[ p.x ] );
+        km[ i ] = magnitude.ptr< float >( ym )[ xm ];
+        ko[ i ] = magnitude.ptr< float >( p.y )[ p.x ];
+        kp[ i ] = magnitude.ptr< float >( yp )[ xp ];
+        px[ i ] = static_cast< float >( p.x );
+        py[ i ] = static_cast< float >( p.y );
+        sx[ i ] = static_cast< float >( stepX );
+        sy[ i ] = static_cast< float >( stepY );
+    }
+
+    // Branch free, the conditions become selects
+    for ( size_t i = 0; i < count; i++ )
+    {
+        const auto top = km[ i ] - kp[ i ];
+        const auto bottom = km[ i ] - 2.0f * ko[ i ] + kp[ i ];
+        const auto valid =
+            std::fabs( bottom ) > std::numeric_limits< float >::epsilon( );
+
+        // Division by zero gives inf or nan, both are discarded by the select
+        const auto vertex = 0.5f * top / bottom;
+        const auto inside = std::fabs( vertex ) <= 0.5f;
+        const auto n = ( valid & inside ) ? vertex : 0.0f;
+
+        // A zero gradient gives a zero direction
+        const auto norm = std::sqrt( gx[ i ] * gx[ i ] + gy[ i ] * gy[ i ] );
+        const auto inverseNorm =
+            1.0f / ( norm + ( norm > 0.0f ? 0.0f : 1.0f ) );
+
+        outX[ i ] = px[ i ] + n * sx[ i ];
+        outY[ i ] = py[ i ] + n * sy[ i ];
+        outResponse[ i ] = ko[ i ];
+        outDirectionX[ i ] = gx[ i ] * inverseNorm;
+        outDirectionY[ i ] = gy[ i ] * inverseNorm;
+    }
+}
+
+void extractSubPixelPositions( const GradientPlanes& planes,
+                               const cv::Point2i* points, size_t numberPoints,
+                               ContourSet& contours, ThreadPool* threadPool )
+{
+    CV_Assert( planes.derivativeX.type( ) == planes.derivativeY.type( ) );
+
+    const auto type = planes.derivativeX.type( );
+    if ( type != CV_16SC1 && type != CV_32FC1 )
+    {
+        throw std::invalid_argument(
+            "Derivatives must be CV_16SC1 or CV_32FC1" );
+    }
 
-    cv::eigen( src, eigenValues, eigenVectors );
-    // const cv::PCA pca( src, cv::Mat( ), cv::PCA::DATA_AS_ROW, 0 );
+    const auto first = contours.x.size( );
+    contours.x.resize( first + numberPoints );
+    contours.y.resize( first + numberPoints );
+    contours.response.resize( first + numberPoints );
+    contours.directionX.resize( first + numberPoints );
+    contours.directionY.resize( first + numberPoints );
 
-    eigenValue1 = eigenValues.at< float >( 0, 0 );
-    eigenValue2 = eigenValues.at< float >( 1, 0 );
-    // std::cout << eigenValues << '\n';
+    const auto interpolateBlocks = [ & ]( size_t chunkBegin, size_t chunkEnd )
+    {
+        for ( auto begin = chunkBegin; begin < chunkEnd;
+              begin += kInterpolationBlock )
+        {
+            const auto end = std::min( begin + kInterpolationBlock, chunkEnd );
+            const auto out = first + begin;
 
-    eigenVector1 = eigenVectors.at< cv::Vec2f >( 0, 0 );
-    eigenVector2 = eigenVectors.at< cv::Vec2f >( 1, 0 );
-    // std::cout << eigenVectors << '\n';
+            if ( type == CV_16SC1 )
+            {
+                interpolateSubPixelBlock< int16_t >(
+                    planes,
+                    points,
+                    begin,
+                    end,
+                    &contours.x[ out ],
+                    &contours.y[ out ],
+                    &contours.response[ out ],
+                    &contours.directionX[ out ],
+                    &contours.directionY[ out ] );
+            }
+            else
+            {
+                interpolateSubPixelBlock< float >(
+                    planes,
+                    points,
+                    begin,
+                    end,
+                    &contours.x[ out ],
+                    &contours.y[ out ],
+                    &contours.response[ out ],
+                    &contours.directionX[ out ],
+                    &contours.directionY[ out ] );
+            }
+        }
+    };
+
+    // The chunks are multiples of the block size, so the blocks are the same
+    // with and without a pool
+    parallelFor( threadPool,
+                 0,
+                 static_cast< int32_t >( numberPoints ),
+                 static_cast< int32_t >( kInterpolationBlock ),
+                 [ & ]( int32_t begin, int32_t end )
+                 {
+                     interpolateBlocks( static_cast< size_t >( begin ),
+                                        static_cast< size_t >( end ) );
+                 } );
 }
 
-void calculateEigenValuesVectorsSelf( const cv::Mat& src, float& eigenValue1,
-                                      float& eigenValue2,
-                                      cv::Point2f& eigenVector1,
-                                      cv::Point2f& eigenVector2 )
+/*
+ * Function that calculates the eigenvalues and eigenvectors of a symmetric 2x2
+ * matrix in closed form. Like cv::eigen the first eigenvalue is the larger
+ * one.
+ *
+ * @param [in]  fxx             The upper left element
+ * @param [in]  fxy             The off diagonal element
+ * @param [in]  fyy             The lower right element
+ * @param [out] eigenValue1     The larger eigenvalue
+ * @param [out] eigenValue2     The smaller eigenvalue
+ * @param [out] eigenVector1    The unit eigenvector of eigenValue1
+ * @param [out] eigenVector2    The unit eigenvector of eigenValue2
+ *
+ */
+inline void calculateEigenValuesVectorsSymmetric( float fxx, float fxy,
+                                                  float fyy, float& eigenValue1,
+                                                  float& eigenValue2,
+                                                  cv::Point2f& eigenVector1,
+                                                  cv::Point2f& eigenVector2 )
 {
-    const auto fxx = src.at< float >( 0, 0 );
-    const auto fxy = src.at< float >( 0, 1 );
-    const auto fyy = src.at< float >( 1, 1 );
-
     // According to the paper we need to calculate the eigenvalues and
     // eigenvectors of the hessian to determine the subpixel position
     // https://people.math.harvard.edu/~knill/teaching/math21b2004/exhibits/2dmatrices/index.html
@@ -1572,120 +1912,37 @@ void calculateEigenValuesVectorsSelf( const cv::Mat& src, float& eigenValue1,
     const auto secondTerm =
         0.5f * std::sqrt( 4.0f * fxy * fxy + ( fxx - fyy ) * ( fxx - fyy ) );
 
-    eigenValue1 = firstTerm - secondTerm;
+    eigenValue1 = firstTerm + secondTerm;
+    eigenValue2 = firstTerm - secondTerm;
 
-    eigenValue2 = firstTerm + secondTerm;
+    // ( A - lambda * I ) * v = 0 gives the two candidates
+    //
+    //      |     fxy      |        | lambda - fyy |
+    // v1 = |              | ; v2 = |              |
+    //      | lambda - fxx |        |     fxy      |
+    //
+    // Both vanish if fxy is zero and lambda is the matching diagonal element,
+    // the longer one is the stable choice.
+    const cv::Point2f candidate1( fxy, eigenValue1 - fxx );
+    const cv::Point2f candidate2( eigenValue1 - fyy, fxy );
 
-    if ( eigenValue2 > eigenValue1 )
-    {
-        std::swap( eigenValue1, eigenValue2 );
-    }
+    const auto norm1 = candidate1.dot( candidate1 );
+    const auto norm2 = candidate2.dot( candidate2 );
 
-    // If element b or c is equal to zero we cannot calculate the eigenvectors.
-    // We set the eigenvectors to [0, 1] and [1, 0]
-    if ( isZero( fxy ) )
+    if ( isZero( norm1 ) && isZero( norm2 ) )
     {
-        eigenVector1 = { 1.0, 0.0 };
-        eigenVector2 = { 0.0, 1.0 };
+        // Multiple of the identity, every vector is an eigenvector
+        eigenVector1 = { 1.0f, 0.0f };
     }
-    else
+    else if ( norm1 >= norm2 )
     {
-        // To get the corresponding eigenvector we need to full fill
-        // ( A - lambda * I) * v = 0
-        //
-        // | (a - lambda)       b       |   | x |   | 0 |
-        // |                            | * |   | = |   |
-        // |      c        (d - lambda) |   | y |   | 0 |
-        //
-        // (a - lambda) * x + b * y = 0
-        // c * x + (d - lambda) * y = 0
-        //
-        // y = (lambda - a) * x / b
-        // y = c * x / (lambda - d)
-        //
-        // y = y
-        //
-        // (lambda - a) * x       c * x
-        // ----------------- = -------------
-        //         b           (lambda - d)
-        //
-        // Choosing x to be denominator of each fraction
-        //
-        // lambda - a        c
-        // ----------- = ----------
-        //      b        lambda - d
-        //
-        // e.g x = b leads to
-        // x = b and y = lambda - a
-        //
-        // e.g x = c  leads to
-        //
-        // reforming
-        // x = y * (lambda - d) / c and choosing y = c leads to
-        // x = lambda - d and y = c
-        //
-        //      |     b      |        | lambda - d |
-        // v1 = |            | ; v2 = |            |
-        //      | lambda - a |        |     c      |
-
-        // Now we need the corresponding eigenvectors
-        eigenVector1 = { fxy, eigenValue1 - fxx };
-        eigenVector2 = { eigenValue2 - fyy, fxy };
-
-        eigenVector1 /= cv::norm( eigenVector1 );
-        eigenVector2 /= cv::norm( eigenVector2 );
+        eigenVector1 = candidate1 / std::sqrt( norm1 );
     }
-}
-
-void imageNeighbourhood( const cv::Mat& image, const cv::Point2i& position,
-                         const Neighbourhood& neighbourhood,
-                         std::vector< float >& magnitudes )
-{
-    const auto imageWidth = image.cols;
-    const auto imageHeight = image.rows;
-
-    const auto x = position.x;
-    const auto y = position.y;
-
-    const auto top = y - 1 >= 0 ? y - 1 : y;
-    const auto down = y + 1 < imageHeight ? y + 1 : y;
-    const auto left = x - 1 >= 0 ? x - 1 : x;
-    const auto right = x + 1 < imageWidth ? x + 1 : x;
-
-    switch ( neighbourhood )
-    {
-    case Neighbourhood::FourConnected:
+    else
     {
-        magnitudes[ 0 ] = pixelValue( image, cv::Point2i( x, top ) );
-        magnitudes[ 1 ] = pixelValue( image, cv::Point2i( left, y ) );
-        magnitudes[ 2 ] = pixelValue( image, cv::Point2i( x, y ) );
-        magnitudes[ 3 ] = pixelValue( image, cv::Point2i( right, y ) );
-        magnitudes[ 4 ] = pixelValue( image, cv::Point2i( x, down ) );
-        break;
+        eigenVector1 = candidate2 / std::sqrt( norm2 );
     }
 
-    case Neighbourhood::EightConnected:
-    {
-        magnitudes[ 0 ] = pixelValue( image, cv::Point2i( left, top ) );
-        magnitudes[ 1 ] = pixelValue( image, cv::Point2i( x, top ) );
-        magnitudes[ 2 ] = pixelValue( image, cv::Point2i( right, top ) );
-        magnitudes[ 3 ] = pixelValue( image, cv::Point2i( left, y ) );
-        magnitudes[ 4 ] = pixelValue( image, cv::Point2i( x, y ) );
-        magnitudes[ 5 ] = pixelValue( image, cv::Point2i( right, y ) );
-        magnitudes[ 6 ] = pixelValue( image, cv::Point2i( left, down ) );
-        magnitudes[ 7 ] = pixelValue( image, cv::Point2i( x, down ) );
-        magnitudes[ 8 ] = pixelValue( image, cv::Point2i( right, down ) );
-        break;
-    }
-    }
+    // The eigenvectors of a symmetric matrix are orthogonal
+    eigenVector2 = { -eigenVector1.y, eigenVector1.x };
 }
-
-float pixelValue( const cv::Mat& image, const cv::Point2i& position )
-{
-    const auto x = position.x;
-    const auto y = position.y;
-
-    const auto rowPtr = image.ptr< uint8_t >( y );
-
-    return rowPtr[ x ];
-}
\ No newline at end of file
@@ -1,11 +1,19 @@
 #pragma once
 
+#include "NonMaximumSuppression.h"
+
 // Std includes
+#include <memory_resource>
 #include <vector>
 
 // OpenCV includes
 #include <opencv2/core.hpp>
 
+class EdgeBitmap;
+class FrameArena;
+class Graph;
+class ThreadPool;
+
 struct Contour
 {
     std::vector< cv::Point2f > subPixContour;
@@ -13,6 +21,180 @@ struct Contour
     std::vector< cv::Point2f > direction;
 };
 
+/*
+ * All contours of a frame in one flat structure of arrays. The points of
+ * contour i are [offsets[i], offsets[i + 1]) in every array. The buffers keep
+ * their capacity when the set is reused for the next frame.
+ */
+struct ContourSet
+{
+    std::vector< float > x;
+    std::vector< float > y;
+    std::vector< float > response;
+    std::vector< float > directionX;
+    std::vector< float > directionY;
+
+    // Number of contours + 1 entries, the first one is always 0
+    std::vector< size_t > offsets { 0 };
+
+    // The number of contours
+    size_t size( ) const { return offsets.size( ) - 1; }
+
+    // Removes all contours, the capacity is kept
+    void clear( )
+    {
+        x.clear( );
+        y.clear( );
+        response.clear( );
+        directionX.clear( );
+        directionY.clear( );
+        offsets.assign( 1, 0 );
+    }
+};
+
+enum class BlurMethod
+{
+    // cv::GaussianBlur, the cost grows with the kernel size
+    Gaussian,
+    // Recursive Gaussian, constant cost per pixel for every kernel size
+    Recursive
+};
+
+enum class ContourOrdering
+{
+    // Junction aware chain linking, linear in the number of edge pixels
+    ChainLinking,
+    // Connected components ordered by shortest paths between their endpoints
+    ShortestPaths
+};
+
+enum class SubPixelMethod
+{
+    // Parabola through the magnitudes along the quantized gradient direction
+    Interpolation,
+    // Ridge of the second facet model fitted to the magnitude
+    SecondFacet,
+    // Parabola through the magnitudes sampled along the exact gradient
+    // direction, after Devernay
+    Devernay
+};
+
+struct EdgeDetectionOptions
+{
+    // Filter used for the blur stage
+    BlurMethod blurMethod { BlurMethod::Gaussian };
+
+    // Optional thread pool for the parallel stages, not owned. Without a pool
+    // everything runs on the calling thread.
+    ThreadPool* threadPool { nullptr };
+
+    // Norm of the magnitude plane. The thresholds apply to this magnitude and
+    // all subpixel extractors read it.
+    MagnitudeType magnitudeType { MagnitudeType::L1 };
+
+    // How the edge pixels are ordered into contours
+    ContourOrdering contourOrdering { ContourOrdering::ChainLinking };
+
+    // Optional arena for the scratch memory of the contour stages, not owned.
+    // It is reset at the start of every call.
+    FrameArena* arena { nullptr };
+
+    // How the subpixel position of an edge pixel is extracted. It is selected
+    // once per frame, every method has its own inlined loop over the points.
+    SubPixelMethod subPixelMethod { SubPixelMethod::Interpolation };
+
+    // Calculates the facet coefficients of all edge rows in one dense pass
+    // for SubPixelMethod::SecondFacet instead of fitting every point. Pays
+    // off when more than a few percent of the pixels are edges.
+    bool denseFacetPlanes { false };
+
+    // Edge length of the tiles the local stages run on, 0 runs them over the
+    // whole frame. Each tile runs the Gaussian blur, the Sobel derivatives
+    // and the non maximum suppression with a halo on its own worker of the
+    // thread pool. The recursive blur and the Deriche filter have an
+    // unbounded support, they run over the whole frame and only their
+    // suppression is tiled. The hysteresis and the contour ordering run on
+    // the assembled frame, so the result equals the untiled one.
+    int32_t tileSize { 0 };
+};
+
+/*
+ * Function that calculates the sub pixel position, the response and the
+ * direction of a list of edge pixels by parabolic interpolation of the
+ * magnitude along the quantized gradient direction. The points are processed
+ * in blocks, a gather loop loads the magnitudes of a block and a branch free
+ * loop over the block calculates the results.
+ *
+ * The results are appended to x, y, response, directionX and directionY of
+ * contours, the offsets are not touched.
+ *
+ * @param [in]  planes          The gradient planes of the image
+ * @param [in]  points          The edge pixels
+ * @param [in]  numberPoints    The number of edge pixels
+ * @param [out] contours        The contour set receiving the results
+ * @param [in]  threadPool      Optional thread pool
+ */
+void extractSubPixelPositions( const GradientPlanes& planes,
+                               const cv::Point2i* points, size_t numberPoints,
+                               ContourSet& contours,
+                               ThreadPool* threadPool = nullptr );
+
+/*
+ * Function that labels the 8 connected components of an edge bitmap. The
+ * components are ordered by their first pixel in scan order. The points of a
+ * provisional label are in scan order, the points of merged labels follow
+ * behind them. The points of component i are [offsets[i], offsets[i + 1]).
+ * The scratch memory comes from the memory resource of points.
+ *
+ * @param [in]  edges   The edge bitmap
+ * @param [out] points  The points of all components
+ * @param [out] offsets The start of every component and the end of the last
+ */
+void labelContours( const EdgeBitmap& edges,
+                    std::pmr::vector< cv::Point2i >& points,
+                    std::pmr::vector< size_t >& offsets );
+
+/*
+ * Function that calculates an adjacency matrix for a contour. Instead of
+ * comparing all pairs of points, the neighbours of a point are looked up in an
+ * index image, which makes it linear in the number of points. The neighbours
+ * are added in ascending order, so the adjacency lists are the same as the
+ * ones of the pairwise comparison.
+ *
+ * @param [in]     contourPoints The contour point to calculate the matrix for.
+ * @param [in,out] indexImage    Image (CV_32SC1) covering all contour points.
+ *                               It has to be -1 everywhere and is -1 again on
+ *                               return.
+ * @param [in,out] graph         The graph with one vertex per contour point
+ *                               receiving the edges
+ */
+void calculateAdjacencyMatrix( const std::vector< cv::Point2i >& contourPoints,
+                               cv::Mat& indexImage, Graph& graph );
+
 std::vector< Contour > edgesSubPix( const cv::Mat& imageIn, int32_t blurSize, double alpha, int32_t edgeDetector,
                                     int32_t derivativeSize, double lowThreshold,
-                                    double highThreshold );
\ No newline at end of file
+                                    double highThreshold,
+                                    const EdgeDetectionOptions& options = { } );
+
+/*
+ * Function that detects the sub pixel contours like edgesSubPix, but writes
+ * them to a flat contour set. The set is cleared first, passing the same set
+ * every frame avoids the allocations per contour.
+ *
+ * @param [in]  imageIn         The input image (CV_8UC1)
+ * @param [in]  blurSize        The blur radius, 0 disables the blur
+ * @param [in]  alpha           The Deriche alpha
+ * @param [in]  edgeDetector    0 for Sobel, 1 for Deriche
+ * @param [in]  derivativeSize  The Sobel aperture size, 1, 3, 5, 7 or -1 for
+ *                              Scharr. 3, 5 and 7 run fused with the non
+ *                              maximum suppression.
+ * @param [in]  lowThreshold    The low threshold
+ * @param [in]  highThreshold   The high threshold
+ * @param [out] contours        The contours
+ * @param [in]  options         The pipeline options
+ */
+void edgesSubPix( const cv::Mat& imageIn, int32_t blurSize, double alpha,
+                  int32_t edgeDetector, int32_t derivativeSize,
+                  double lowThreshold, double highThreshold,
+                  ContourSet& contours,
+                  const EdgeDetectionOptions& options = { } );
@@ -0,0 +1,178 @@
+#include "ThreadPool.h"
+
+// Std includes
+#include <algorithm>
+
+namespace
+{
+// Set while the thread runs a chunk of a parallelFor, nested calls run their
+// body on that thread instead of waiting for the workers
+thread_local bool tInsideChunk { false };
+} // namespace
+
+ThreadPool::ThreadPool( size_t numberThreads )
+{
+    // The calling thread always runs the first chunk itself
+    const auto numberWorkers = std::max< size_t >( numberThreads, 1 ) - 1;
+
+    mWorkers.reserve( numberWorkers );
+
+    for ( size_t i = 0; i < numberWorkers; i++ )
+    {
+        mWorkers.emplace_back( [ this ] { workerLoop( ); } );
+    }
+}
+
+ThreadPool::~ThreadPool( )
+{
+    {
+        std::lock_guard< std::mutex > lock( mMutex );
+        mStop = true;
+    }
+
+    mTaskAvailable.notify_all( );
+
+    for ( auto& worker : mWorkers )
+    {
+        worker.join( );
+    }
+}
+
+size_t ThreadPool::size( ) const
+{
+    return mWorkers.size( ) + 1;
+}
+
+void ThreadPool::workerLoop( )
+{
+    while ( true )
+    {
+        std::function< void( ) > task;
+
+        {
+            std::unique_lock< std::mutex > lock( mMutex );
+            mTaskAvailable.wait(
+                lock, [ this ] { return mStop || ! mTasks.empty( ); } );
+
+            if ( mStop && mTasks.empty( ) )
+            {
+                return;
+            }
+
+            task = std::move( mTasks.front( ) );
+            mTasks.pop( );
+        }
+
+        task( );
+    }
+}
+
+void ThreadPool::parallelFor(
+    int32_t begin, int32_t end, int32_t grain,
+    const std::function< void( int32_t, int32_t ) >& body )
+{
+    if ( end <= begin )
+    {
+        return;
+    }
+
+    // The workers may all be busy with the outer chunks and waiting for them
+    // would deadlock
+    if ( tInsideChunk )
+    {
+        body( begin, end );
+        return;
+    }
+
+    grain = std::max( grain, 1 );
+
+    //
+    // Split the range into equally sized chunks of whole grains
+    //
+    const auto numberGrains = ( end - begin + grain - 1 ) / grain;
+    const auto numberChunks =
+        std::min( static_cast< int32_t >( size( ) ), numberGrains );
+    const auto grainsPerChunk =
+        ( numberGrains + numberChunks - 1 ) / numberChunks;
+    const auto chunkSize = grainsPerChunk * grain;
+
+    if ( numberChunks == 1 )
+    {
+        body( begin, end );
+        return;
+    }
+
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    int32_t pending { };
+    std::exception_ptr exception;
+
+    const auto runChunk = [ & ]( int32_t chunkBegin, int32_t chunkEnd )
+    {
+        tInsideChunk = true;
+
+        try
+        {
+            body( chunkBegin, chunkEnd );
+        }
+        catch ( ... )
+        {
+            std::lock_guard< std::mutex > lock( doneMutex );
+            if ( ! exception )
+            {
+                exception = std::current_exception( );
+            }
+        }
+
+        tInsideChunk = false;
+    };
+
+    {
+        std::lock_guard< std::mutex > lock( mMutex );
+
+        for ( auto chunkBegin = begin + chunkSize; chunkBegin < end;
+              chunkBegin += chunkSize )
+        {
+            const auto chunkEnd = std::min( chunkBegin + chunkSize, end );
+            pending++;
+
+            mTasks.emplace(
+                [ &, chunkBegin, chunkEnd ]
+                {
+                    runChunk( chunkBegin, chunkEnd );
+
+                    std::lock_guard< std::mutex > doneLock( doneMutex );
+                    if ( --pending == 0 )
+                    {
+                        doneCondition.notify_one( );
+                    }
+                } );
+        }
+    }
+
+    mTaskAvailable.notify_all( );
+
+    runChunk( begin, std::min( begin + chunkSize, end ) );
+
+    std::unique_lock< std::mutex > lock( doneMutex );
+    doneCondition.wait( lock, [ & ] { return pending == 0; } );
+
+    if ( exception )
+    {
+        std::rethrow_exception( exception );
+    }
+}
+
+void parallelFor( ThreadPool* threadPool, int32_t begin, int32_t end,
+                  int32_t grain,
+                  const std::function< void( int32_t, int32_t ) >& body )
+{
+    if ( threadPool != nullptr )
+    {
+        threadPool->parallelFor( begin, end, grain, body );
+    }
+    else if ( begin < end )
+    {
+        body( begin, end );
+    }
+}
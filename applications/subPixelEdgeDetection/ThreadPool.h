@@ -0,0 +1,74 @@
+#pragma once
+
+// Std includes
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    // A pool with one thread runs everything on the calling thread.
+    explicit ThreadPool(
+        size_t numberThreads = std::thread::hardware_concurrency( ) );
+
+    ThreadPool( const ThreadPool& ) = delete;
+    ThreadPool& operator=( const ThreadPool& ) = delete;
+    ThreadPool( ThreadPool&& ) = delete;
+    ThreadPool& operator=( ThreadPool&& ) = delete;
+    ~ThreadPool( );
+
+    size_t size( ) const;
+
+    /*
+     * Function that splits the range [begin, end) into at most size()
+     * contiguous chunks and calls body( chunkBegin, chunkEnd ) for each of
+     * them in parallel. Chunk boundaries are multiples of grain relative to
+     * begin and only depend on the range and the pool size, so the
+     * partitioning is deterministic. The call returns when all chunks are
+     * done, the first exception thrown by a chunk is rethrown.
+     *
+     * A parallelFor called from inside a chunk, on this or any other pool,
+     * runs its whole range on the calling thread. The outer chunks occupy
+     * the workers, waiting for them from inside a chunk could deadlock.
+     *
+     * @param [in]  begin   The first index of the range
+     * @param [in]  end     The index behind the last index of the range
+     * @param [in]  grain   The chunk size granularity
+     * @param [in]  body    The function called for every chunk
+     */
+    void parallelFor( int32_t begin, int32_t end, int32_t grain,
+                      const std::function< void( int32_t, int32_t ) >& body );
+
+private:
+    void workerLoop( );
+
+    std::vector< std::thread > mWorkers;
+
+    std::queue< std::function< void( ) > > mTasks;
+
+    std::mutex mMutex;
+
+    std::condition_variable mTaskAvailable;
+
+    bool mStop { false };
+};
+
+/*
+ * Function that runs body over [begin, end) either in parallel on the given
+ * pool or directly on the calling thread if no pool is given.
+ *
+ * @param [in]  threadPool  The thread pool or nullptr
+ * @param [in]  begin       The first index of the range
+ * @param [in]  end         The index behind the last index of the range
+ * @param [in]  grain       The chunk size granularity
+ * @param [in]  body        The function called for every chunk
+ */
+void parallelFor( ThreadPool* threadPool, int32_t begin, int32_t end,
+                  int32_t grain,
+                  const std::function< void( int32_t, int32_t ) >& body );
@@ -1,5 +1,9 @@
 #include "Deriche.h"
+#include "FrameArena.h"
+#include "NonMaximumSuppression.h"
+#include "RecursiveGaussian.h"
 #include "SubPixelDetection.h"
+#include "ThreadPool.h"
 
 // OpenCV includes
 #include <opencv2/core.hpp>
@@ -23,6 +27,21 @@ int apertureIndex = 0;
 int blurAmount = 0;
 int maxBlurAmount = 20;
 
+// Blur method
+int blurMethod = 0;
+int maxBlurMethod = 1;
+// 0 -> GaussianBlur, 1 -> Recursive Gaussian
+
+// Magnitude type
+int magnitudeType = 0;
+int maxMagnitudeType = 1;
+// 0 -> L1, 1 -> L2
+
+// Subpixel method
+int subPixelMethod = 0;
+int maxSubPixelMethod = 2;
+// 0 -> Interpolation, 1 -> Second facet, 2 -> Devernay
+
 // Edge detector
 int edgeDetector = 0;
 int maxEdgeDetector = 1;
@@ -35,14 +54,32 @@ bool drawGradient { false };
 
 std::string windowName = "SubPixel Detector";
 
+// The resources of the detector, owned by main and passed to the trackbar
+// callback as user data
+struct DetectorResources
+{
+    ThreadPool& threadPool;
+    FrameArena& frameArena;
+};
+
 // Function for trackbar call
-void applyCanny( int, void* )
+void applyCanny( int, void* userData )
 {
+    auto& [ threadPool, frameArena ] =
+        *static_cast< DetectorResources* >( userData );
+
     // Variable to store blurred image
     cv::Mat blurredSrc;
 
     // Blur the image before edge detection
-    if ( blurAmount > 0 )
+    if ( blurAmount > 0 && blurMethod == 1 )
+    {
+        recursiveGaussianBlur( source,
+                               blurredSrc,
+                               gaussianSigma( 2 * blurAmount + 1 ),
+                               &threadPool );
+    }
+    else if ( blurAmount > 0 )
     {
         cv::GaussianBlur( source,
                           blurredSrc,
@@ -57,29 +94,47 @@ void applyCanny( int, void* )
     // Canny requires aperture size to be odd
     const int32_t apertureSize = apertureSizes[ apertureIndex ];
 
-    cv::Mat derivativeX;
-    cv::Mat derivativeY;
     const auto alpha = alphaFactor / 100.0;
+    const auto magnitude =
+        magnitudeType == 1 ? MagnitudeType::L2 : MagnitudeType::L1;
+    GradientPlanes planes;
 
     if ( edgeDetector == 0 )
     {
-        cv::Sobel( blurredSrc, derivativeX, CV_16SC1, 1, 0, apertureSize );
-        cv::Sobel( blurredSrc, derivativeY, CV_16SC1, 0, 1, apertureSize );
+        sobelNonMaximumSuppression( blurredSrc,
+                                    apertureSize,
+                                    lowThreshold,
+                                    highThreshold,
+                                    planes,
+                                    magnitude,
+                                    &threadPool );
     }
     else
     {
-        const auto omega = alpha / 1000;
-        dericheX( blurredSrc, derivativeX, alpha, omega );
-        dericheY( blurredSrc, derivativeY, alpha, omega );
-        derivativeX.convertTo( derivativeX, CV_16SC1 );
-        derivativeY.convertTo( derivativeY, CV_16SC1 );
+        cv::Mat derivativeX;
+        cv::Mat derivativeY;
+        const auto coeff = getDericheCoefficients( alpha, alpha / 1000 );
+        dericheXY( blurredSrc,
+                   derivativeX,
+                   derivativeY,
+                   coeff,
+                   CV_32F,
+                   &threadPool );
+
+        nonMaximumSuppression( derivativeX,
+                               derivativeY,
+                               lowThreshold,
+                               highThreshold,
+                               planes,
+                               magnitude,
+                               &threadPool );
     }
 
     // Apply canny to get the edges
     // cv::Canny( blurredSrc, edges, lowThreshold, highThreshold, apertureSize
     // );
 
-    cv::Canny( derivativeX, derivativeY, edges, lowThreshold, highThreshold );
+    hysteresis( planes.edgeClasses, edges );
 
     auto contours = edgesSubPix( source,
                                  blurAmount,
@@ -87,7 +142,15 @@ void applyCanny( int, void* )
                                  edgeDetector,
                                  apertureSizes[ apertureIndex ],
                                  lowThreshold,
-                                 highThreshold );
+                                 highThreshold,
+                                 { blurMethod == 1 ? BlurMethod::Recursive
+                                                   : BlurMethod::Gaussian,
+                                   &threadPool,
+                                   magnitude,
+                                   ContourOrdering::ChainLinking,
+                                   &frameArena,
+                                   static_cast< SubPixelMethod >(
+                                       subPixelMethod ) } );
 
     //
     // To be able to draw contours in color, the images needs to be converted
@@ -194,6 +257,14 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
         cv::GaussianBlur( source, source, cv::Size( 15, 15 ), 0 );
     }
 
+    // Worker threads for the parallel stages, one per core
+    ThreadPool threadPool;
+
+    // Scratch memory of the contour stages, reused for every frame
+    FrameArena frameArena;
+
+    DetectorResources resources { threadPool, frameArena };
+
     // Display images
     cv::imshow( windowName, source );
 
@@ -201,37 +272,76 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     cv::namedWindow( windowName, cv::WINDOW_AUTOSIZE );
 
     // Trackbar to control the low threshold
-    cv::createTrackbar(
-        "Low Threshold", windowName, &lowThreshold, maxThreshold, applyCanny );
+    cv::createTrackbar( "Low Threshold",
+                        windowName,
+                        &lowThreshold,
+                        maxThreshold,
+                        applyCanny,
+                        &resources );
 
     // Trackbar to control the high threshold
     cv::createTrackbar( "High Threshold",
                         windowName,
                         &highThreshold,
                         maxThreshold,
-                        applyCanny );
+                        applyCanny,
+                        &resources );
 
     // Trackbar to control the aperture size
     cv::createTrackbar( "aperture Size",
                         windowName,
                         &apertureIndex,
                         maxapertureIndex,
-                        applyCanny );
+                        applyCanny,
+                        &resources );
 
     // Trackbar to control the edge detector
     cv::createTrackbar( "Edge Detector",
                         windowName,
                         &edgeDetector,
                         maxEdgeDetector,
-                        applyCanny );
+                        applyCanny,
+                        &resources );
 
     // Trackbar to control the alpha factor
-    cv::createTrackbar(
-        "Alpha", windowName, &alphaFactor, maxAlphaFactor, applyCanny );
+    cv::createTrackbar( "Alpha",
+                        windowName,
+                        &alphaFactor,
+                        maxAlphaFactor,
+                        applyCanny,
+                        &resources );
 
     // Trackbar to control the blur
-    cv::createTrackbar(
-        "Blur", windowName, &blurAmount, maxBlurAmount, applyCanny );
+    cv::createTrackbar( "Blur",
+                        windowName,
+                        &blurAmount,
+                        maxBlurAmount,
+                        applyCanny,
+                        &resources );
+
+    // Trackbar to control the blur method
+    cv::createTrackbar( "Blur Method",
+                        windowName,
+                        &blurMethod,
+                        maxBlurMethod,
+                        applyCanny,
+                        &resources );
+
+    // Trackbar to control the magnitude type
+    cv::createTrackbar( "Magnitude",
+                        windowName,
+                        &magnitudeType,
+                        maxMagnitudeType,
+                        applyCanny,
+                        &resources );
+
+    // Trackbar to control the subpixel method
+    cv::createTrackbar( "SubPixel",
+                        windowName,
+                        &subPixelMethod,
+                        maxSubPixelMethod,
+                        applyCanny,
+                        &resources );
 
     int key { };
 
@@ -240,7 +350,7 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
         if ( key == 'g' )
         {
             drawGradient = ! drawGradient;
-            applyCanny( 0, nullptr );
+            applyCanny( 0, &resources );
         }
 
         key = cv::waitKey( 20 ) & 0xFF;
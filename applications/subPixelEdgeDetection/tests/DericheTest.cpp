@@ -0,0 +1,307 @@
+#include "Deriche.h"
+#include "TestImages.h"
+#include "ThreadPool.h"
+
+// Std includes
+#include <array>
+#include <vector>
+
+// GTest includes
+#include <gtest/gtest.h>
+
+namespace
+{
+// Number of workers, fixed so the images are split on every machine
+constexpr size_t kNumberThreads = 4;
+
+// Deriche alphas, omega is alpha / 1000 as in edgesSubPix
+constexpr std::array< double, 3 > kAlphas = { 0.5, 1.0, 2.0 };
+
+// The synthetic images followed by the noise images
+cv::Mat testImage( int32_t index )
+{
+    return index < kNumberTestImages
+               ? syntheticImage( index )
+               : noiseImage( index - kNumberTestImages );
+}
+
+/*
+ * Function that runs the derivative recursion over one line, like the filter
+ * did before the columns were blocked.
+ *
+ * @param [in]  line    The input samples
+ * @param [in]  coeff   The filter coefficients
+ *
+ * @returns The derivative S
+ */
+std::vector< float > derivativeLine( const std::vector< float >& line,
+                                     const DericheCoefficients& coeff )
+{
+    const auto size = static_cast< int32_t >( line.size( ) );
+    std::vector< float > s( line.size( ) );
+
+    // Y+(k) = I(k - 1) - b1 * Y+(k - 1) - b2 * Y+(k - 2)
+    float y2 = 0.0f;
+    float y1 = line[ 0 ];
+    s[ 0 ] = coeff.a * y1;
+
+    for ( int32_t k = 1; k < size; k++ )
+    {
+        const float yp = line[ k - 1 ] - coeff.b1 * y1 - coeff.b2 * y2;
+        s[ k ] = coeff.a * yp;
+        y2 = y1;
+        y1 = yp;
+    }
+
+    // Y-(k) = I(k + 1) - b1 * Y-(k + 1) - b2 * Y-(k + 2)
+    y2 = 0.0f;
+    y1 = line[ size - 1 ];
+    s[ size - 1 ] -= coeff.a * y1;
+
+    for ( int32_t k = size - 2; k >= 0; k-- )
+    {
+        const float ym = line[ k + 1 ] - coeff.b1 * y1 - coeff.b2 * y2;
+        s[ k ] -= coeff.a * ym;
+        y2 = y1;
+        y1 = ym;
+    }
+
+    return s;
+}
+
+/*
+ * Function that runs the smoothing recursion over one line, like the filter
+ * did before the columns were blocked.
+ *
+ * @param [in]  s       The derivative S
+ * @param [in]  coeff   The filter coefficients
+ *
+ * @returns The smoothed derivative R
+ */
+std::vector< float > smoothingLine( const std::vector< float >& s,
+                                    const DericheCoefficients& coeff )
+{
+    const auto size = static_cast< int32_t >( s.size( ) );
+    std::vector< float > rp( s.size( ) );
+    std::vector< float > r( s.size( ) );
+
+    // R+(k) = a0 * S(k) + a1 * S(k - 1) - b1 * R+(k - 1) - b2 * R+(k - 2)
+    float r2 = 0.0f;
+    float r1 = coeff.a0 * s[ 0 ];
+    rp[ 0 ] = r1;
+
+    for ( int32_t k = 1; k < size; k++ )
+    {
+        rp[ k ] = coeff.a0 * s[ k ] + coeff.a1 * s[ k - 1 ] - coeff.b1 * r1 -
+                  coeff.b2 * r2;
+        r2 = r1;
+        r1 = rp[ k ];
+    }
+
+    // R-(k) = a2 * S(k + 1) + a3 * S(k + 2) - b1 * R-(k + 1) - b2 * R-(k + 2)
+    r2 = 0.0f;
+    r1 = s[ size - 1 ];
+    r[ size - 1 ] = rp[ size - 1 ] + r1;
+
+    for ( int32_t k = size - 2; k >= 0; k-- )
+    {
+        const auto s2 = k + 2 < size ? s[ k + 2 ] : 0.0f;
+        const float rm = coeff.a2 * s[ k + 1 ] + coeff.a3 * s2 -
+                         coeff.b1 * r1 - coeff.b2 * r2;
+        r[ k ] = rp[ k ] + rm;
+        r2 = r1;
+        r1 = rm;
+    }
+
+    return r;
+}
+
+// The samples of row y or column x of an image as floats
+template < typename T >
+std::vector< float > readLine( const cv::Mat& image, bool row, int32_t index )
+{
+    std::vector< float > line( row ? image.cols : image.rows );
+
+    for ( size_t k = 0; k < line.size( ); k++ )
+    {
+        const auto k32 = static_cast< int32_t >( k );
+        line[ k ] = row ? image.ptr< T >( index )[ k ]
+                        : image.ptr< T >( k32 )[ index ];
+    }
+
+    return line;
+}
+
+// Writes the samples to row y or column x of a CV_32FC1 image
+void writeLine( const std::vector< float >& line, cv::Mat& image, bool row,
+                int32_t index )
+{
+    for ( size_t k = 0; k < line.size( ); k++ )
+    {
+        if ( row )
+        {
+            image.ptr< float >( index )[ k ] = line[ k ];
+        }
+        else
+        {
+            image.ptr< float >( static_cast< int32_t >( k ) )[ index ] =
+                line[ k ];
+        }
+    }
+}
+
+/*
+ * Function that filters an image line by line with the baseline recursions.
+ * The derivative runs along the direction of the derivative, the smoothing
+ * across it.
+ *
+ * @param [in]  image       The input image (CV_8UC1)
+ * @param [in]  coeff       The filter coefficients
+ * @param [in]  derivativeX True for the derivative in x direction
+ *
+ * @returns The derivative (CV_32FC1)
+ */
+cv::Mat perLineDeriche( const cv::Mat& image, const DericheCoefficients& coeff,
+                        bool derivativeX )
+{
+    cv::Mat imageS( image.size( ), CV_32FC1 );
+    cv::Mat imageOut( image.size( ), CV_32FC1 );
+
+    const auto derivativeLines = derivativeX ? image.rows : image.cols;
+    for ( int32_t i = 0; i < derivativeLines; i++ )
+    {
+        writeLine( derivativeLine(
+                       readLine< uint8_t >( image, derivativeX, i ), coeff ),
+                   imageS,
+                   derivativeX,
+                   i );
+    }
+
+    const auto smoothingLines = derivativeX ? image.cols : image.rows;
+    for ( int32_t i = 0; i < smoothingLines; i++ )
+    {
+        writeLine( smoothingLine(
+                       readLine< float >( imageS, ! derivativeX, i ), coeff ),
+                   imageOut,
+                   ! derivativeX,
+                   i );
+    }
+
+    return imageOut;
+}
+
+// Compares two images of the same type element by element
+template < typename T >
+void expectSameImage( const cv::Mat& actual, const cv::Mat& expected )
+{
+    ASSERT_EQ( actual.type( ), expected.type( ) );
+    ASSERT_EQ( actual.size( ), expected.size( ) );
+
+    for ( int32_t y = 0; y < expected.rows; y++ )
+    {
+        for ( int32_t x = 0; x < expected.cols; x++ )
+        {
+            ASSERT_EQ( actual.ptr< T >( y )[ x ], expected.ptr< T >( y )[ x ] )
+                << "x " << x << " y " << y;
+        }
+    }
+}
+
+// The float image saturated to int16
+cv::Mat saturateToInt16( const cv::Mat& image )
+{
+    cv::Mat result( image.size( ), CV_16SC1 );
+
+    for ( int32_t y = 0; y < image.rows; y++ )
+    {
+        for ( int32_t x = 0; x < image.cols; x++ )
+        {
+            result.ptr< int16_t >( y )[ x ] =
+                cv::saturate_cast< int16_t >( image.ptr< float >( y )[ x ] );
+        }
+    }
+
+    return result;
+}
+} // namespace
+
+TEST( Deriche, BlockedColumnsEqualPerLineRecursion )
+{
+    ThreadPool threadPool( kNumberThreads );
+
+    for ( const auto alpha : kAlphas )
+    {
+        SCOPED_TRACE( alpha );
+
+        const auto coeff = getDericheCoefficients( alpha, alpha / 1000 );
+
+        for ( int32_t i = 0; i < 2 * kNumberTestImages; i++ )
+        {
+            SCOPED_TRACE( i );
+
+            const auto image = testImage( i );
+            const auto expectedX = perLineDeriche( image, coeff, true );
+            const auto expectedY = perLineDeriche( image, coeff, false );
+
+            for ( const auto pool : { static_cast< ThreadPool* >( nullptr ),
+                                      &threadPool } )
+            {
+                SCOPED_TRACE( pool == nullptr ? "serial" : "pool" );
+
+                cv::Mat derivativeX;
+                cv::Mat derivativeY;
+                dericheX( image, derivativeX, coeff, pool );
+                dericheY( image, derivativeY, coeff, pool );
+
+                expectSameImage< float >( derivativeX, expectedX );
+                expectSameImage< float >( derivativeY, expectedY );
+            }
+        }
+    }
+}
+
+TEST( Deriche, FusedEqualsSeparate )
+{
+    ThreadPool threadPool( kNumberThreads );
+
+    for ( const auto alpha : kAlphas )
+    {
+        SCOPED_TRACE( alpha );
+
+        const auto coeff = getDericheCoefficients( alpha, alpha / 1000 );
+
+        for ( int32_t i = 0; i < 2 * kNumberTestImages; i++ )
+        {
+            SCOPED_TRACE( i );
+
+            const auto image = testImage( i );
+
+            cv::Mat expectedX;
+            cv::Mat expectedY;
+            dericheX( image, expectedX, coeff );
+            dericheY( image, expectedY, coeff );
+
+            for ( const auto pool : { static_cast< ThreadPool* >( nullptr ),
+                                      &threadPool } )
+            {
+                SCOPED_TRACE( pool == nullptr ? "serial" : "pool" );
+
+                cv::Mat derivativeX;
+                cv::Mat derivativeY;
+                dericheXY(
+                    image, derivativeX, derivativeY, coeff, CV_32F, pool );
+
+                expectSameImage< float >( derivativeX, expectedX );
+                expectSameImage< float >( derivativeY, expectedY );
+
+                dericheXY(
+                    image, derivativeX, derivativeY, coeff, CV_16S, pool );
+
+                expectSameImage< int16_t >( derivativeX,
+                                            saturateToInt16( expectedX ) );
+                expectSameImage< int16_t >( derivativeY,
+                                            saturateToInt16( expectedY ) );
+            }
+        }
+    }
+}
@@ -0,0 +1,230 @@
+#include "EdgeChains.h"
+
+// Std includes
+#include <cstdlib>
+#include <map>
+#include <utility>
+
+// GTest includes
+#include <gtest/gtest.h>
+
+namespace
+{
+// The size of the synthetic edge images
+constexpr int32_t kImageSize = 12;
+
+/*
+ * Function that sets a run of pixels, starting at start and moving by step.
+ *
+ * @param [in,out] image    The edge image (CV_8UC1)
+ * @param [in]     start    The first pixel
+ * @param [in]     step     The offset between two pixels
+ * @param [in]     count    The number of pixels
+ */
+void drawRun( cv::Mat& image, cv::Point2i start, const cv::Point2i& step,
+              int32_t count )
+{
+    for ( int32_t i = 0; i < count; i++, start += step )
+    {
+        image.ptr< uint8_t >( start.y )[ start.x ] = 255;
+    }
+}
+
+// An empty edge image
+cv::Mat emptyImage( )
+{
+    return cv::Mat(
+        kImageSize, kImageSize, CV_8UC1, cv::Scalar::all( 0 ) );
+}
+
+/*
+ * Function that links the chains of an image and checks the invariants all
+ * results share. Every edge pixel is in a chain, the pixels that are not
+ * junctions in exactly one, and the points of a chain are 8 neighbours.
+ *
+ * @param [in]  image   The thin edge image
+ * @param [out] chains  The chains
+ */
+void linkAndCheckCoverage( const cv::Mat& image, EdgeChains& chains )
+{
+    linkEdgeChains( image, chains );
+
+    ASSERT_EQ( chains.offsets.back( ), chains.points.size( ) );
+    ASSERT_EQ( chains.startJunctions.size( ), chains.size( ) );
+    ASSERT_EQ( chains.endJunctions.size( ), chains.size( ) );
+    ASSERT_EQ( chains.closed.size( ), chains.size( ) );
+
+    std::map< std::pair< int32_t, int32_t >, int32_t > uses;
+
+    for ( size_t i = 0; i < chains.size( ); i++ )
+    {
+        SCOPED_TRACE( i );
+
+        for ( auto j = chains.offsets[ i ]; j < chains.offsets[ i + 1 ]; j++ )
+        {
+            const auto& point = chains.points[ j ];
+            EXPECT_NE( image.ptr< uint8_t >( point.y )[ point.x ], 0 );
+            uses[ { point.x, point.y } ]++;
+
+            if ( j > chains.offsets[ i ] )
+            {
+                const auto delta = point - chains.points[ j - 1 ];
+                EXPECT_LE( std::abs( delta.x ), 1 );
+                EXPECT_LE( std::abs( delta.y ), 1 );
+            }
+        }
+    }
+
+    std::map< std::pair< int32_t, int32_t >, int32_t > junctionPixels;
+    for ( const auto& junction : chains.junctions )
+    {
+        junctionPixels[ { junction.x, junction.y } ]++;
+    }
+
+    for ( int32_t y = 0; y < image.rows; y++ )
+    {
+        for ( int32_t x = 0; x < image.cols; x++ )
+        {
+            if ( image.ptr< uint8_t >( y )[ x ] == 0 )
+            {
+                continue;
+            }
+
+            const auto count = uses[ { x, y } ];
+
+            if ( junctionPixels.count( { x, y } ) != 0 )
+            {
+                EXPECT_GE( count, 1 ) << "x " << x << " y " << y;
+            }
+            else
+            {
+                EXPECT_EQ( count, 1 ) << "x " << x << " y " << y;
+            }
+        }
+    }
+}
+
+// The first and the last point of a chain
+std::pair< cv::Point2i, cv::Point2i > chainEnds( const EdgeChains& chains,
+                                                 size_t i )
+{
+    return { chains.points[ chains.offsets[ i ] ],
+             chains.points[ chains.offsets[ i + 1 ] - 1 ] };
+}
+} // namespace
+
+TEST( EdgeChains, StraightLine )
+{
+    auto image = emptyImage( );
+    drawRun( image, { 2, 5 }, { 1, 0 }, 8 );
+
+    EdgeChains chains;
+    linkAndCheckCoverage( image, chains );
+
+    ASSERT_EQ( chains.size( ), 1u );
+    EXPECT_EQ( chains.offsets[ 1 ], 8u );
+    EXPECT_EQ( chains.closed[ 0 ], 0 );
+    EXPECT_EQ( chains.startJunctions[ 0 ], kNoJunction );
+    EXPECT_EQ( chains.endJunctions[ 0 ], kNoJunction );
+    EXPECT_TRUE( chains.junctions.empty( ) );
+
+    const auto ends = chainEnds( chains, 0 );
+    EXPECT_EQ( ends.first, cv::Point2i( 2, 5 ) );
+    EXPECT_EQ( ends.second, cv::Point2i( 9, 5 ) );
+}
+
+TEST( EdgeChains, ClosedLoop )
+{
+    // A diamond of diagonal steps, every pixel has two neighbours
+    auto image = emptyImage( );
+    drawRun( image, { 5, 2 }, { 1, 1 }, 3 );
+    drawRun( image, { 7, 4 }, { -1, 1 }, 3 );
+    drawRun( image, { 5, 6 }, { -1, -1 }, 3 );
+    drawRun( image, { 3, 4 }, { 1, -1 }, 3 );
+
+    EdgeChains chains;
+    linkAndCheckCoverage( image, chains );
+
+    ASSERT_EQ( chains.size( ), 1u );
+    EXPECT_EQ( chains.offsets[ 1 ], 8u );
+    EXPECT_EQ( chains.closed[ 0 ], 1 );
+    EXPECT_EQ( chains.startJunctions[ 0 ], kNoJunction );
+    EXPECT_EQ( chains.endJunctions[ 0 ], kNoJunction );
+    EXPECT_TRUE( chains.junctions.empty( ) );
+}
+
+TEST( EdgeChains, TJunction )
+{
+    // A bar with a gap above the stem, so the junction is one pixel as the
+    // hysteresis leaves it
+    auto image = emptyImage( );
+    drawRun( image, { 1, 5 }, { 1, 0 }, 4 );
+    drawRun( image, { 6, 5 }, { 1, 0 }, 4 );
+    drawRun( image, { 5, 6 }, { 0, 1 }, 4 );
+
+    EdgeChains chains;
+    linkAndCheckCoverage( image, chains );
+
+    ASSERT_EQ( chains.junctions.size( ), 1u );
+    EXPECT_EQ( chains.junctions[ 0 ], cv::Point2i( 5, 6 ) );
+
+    ASSERT_EQ( chains.size( ), 3u );
+
+    for ( size_t i = 0; i < chains.size( ); i++ )
+    {
+        SCOPED_TRACE( i );
+
+        EXPECT_EQ( chains.closed[ i ], 0 );
+        EXPECT_EQ( chains.startJunctions[ i ], kNoJunction );
+        EXPECT_EQ( chains.endJunctions[ i ], 0 );
+        EXPECT_EQ( chainEnds( chains, i ).second, cv::Point2i( 5, 6 ) );
+    }
+
+    // The endpoints in scan order
+    EXPECT_EQ( chainEnds( chains, 0 ).first, cv::Point2i( 1, 5 ) );
+    EXPECT_EQ( chainEnds( chains, 1 ).first, cv::Point2i( 9, 5 ) );
+    EXPECT_EQ( chainEnds( chains, 2 ).first, cv::Point2i( 5, 9 ) );
+}
+
+TEST( EdgeChains, XJunction )
+{
+    auto image = emptyImage( );
+    drawRun( image, { 1, 1 }, { 1, 1 }, 9 );
+    drawRun( image, { 9, 1 }, { -1, 1 }, 9 );
+
+    EdgeChains chains;
+    linkAndCheckCoverage( image, chains );
+
+    ASSERT_EQ( chains.junctions.size( ), 1u );
+    EXPECT_EQ( chains.junctions[ 0 ], cv::Point2i( 5, 5 ) );
+
+    ASSERT_EQ( chains.size( ), 4u );
+
+    for ( size_t i = 0; i < chains.size( ); i++ )
+    {
+        SCOPED_TRACE( i );
+
+        EXPECT_EQ( chains.offsets[ i + 1 ] - chains.offsets[ i ], 5u );
+        EXPECT_EQ( chains.closed[ i ], 0 );
+        EXPECT_EQ( chains.startJunctions[ i ], kNoJunction );
+        EXPECT_EQ( chains.endJunctions[ i ], 0 );
+        EXPECT_EQ( chainEnds( chains, i ).second, cv::Point2i( 5, 5 ) );
+    }
+}
+
+TEST( EdgeChains, IsolatedPixel )
+{
+    auto image = emptyImage( );
+    image.ptr< uint8_t >( 5 )[ 5 ] = 255;
+
+    EdgeChains chains;
+    linkAndCheckCoverage( image, chains );
+
+    ASSERT_EQ( chains.size( ), 1u );
+    EXPECT_EQ( chains.offsets[ 1 ], 1u );
+    EXPECT_EQ( chains.points[ 0 ], cv::Point2i( 5, 5 ) );
+    EXPECT_EQ( chains.closed[ 0 ], 0 );
+    EXPECT_EQ( chains.startJunctions[ 0 ], kNoJunction );
+    EXPECT_EQ( chains.endJunctions[ 0 ], kNoJunction );
+    EXPECT_TRUE( chains.junctions.empty( ) );
+}
@@ -0,0 +1,116 @@
+#include "SubPixelDetection.h"
+#include "TestImages.h"
+
+// Std includes
+#include <algorithm>
+#include <cmath>
+
+// GTest includes
+#include <gtest/gtest.h>
+
+namespace
+{
+// The planes sum the masks in another order than the per point fit
+constexpr float kPositionTolerance = 1e-4f;
+constexpr float kDirectionTolerance = 1e-4f;
+constexpr float kRelativeResponseTolerance = 1e-5f;
+
+// The offset of a coordinate to its pixel is zero
+bool onPixel( float value )
+{
+    return value == std::round( value );
+}
+
+/*
+ * Function that tells if two coordinates differ because one offset is at the
+ * 0.5 limit of the facet model. The offset of one is about 0.5 and the other
+ * one fell back to the pixel.
+ *
+ * @param [in]  lhs     The coordinate of one method
+ * @param [in]  rhs     The coordinate of the other method
+ *
+ * @returns True if the difference comes from the limit
+ */
+bool limitFlip( float lhs, float rhs )
+{
+    const auto difference = std::fabs( lhs - rhs );
+
+    return ( onPixel( lhs ) || onPixel( rhs ) ) &&
+           std::fabs( difference - 0.5f ) < kPositionTolerance;
+}
+
+// Runs the second facet extraction with or without the dense planes
+ContourSet secondFacetContours( const cv::Mat& image, int32_t edgeDetector,
+                                bool denseFacetPlanes )
+{
+    EdgeDetectionOptions options;
+    options.blurMethod = BlurMethod::Recursive;
+    options.subPixelMethod = SubPixelMethod::SecondFacet;
+    options.denseFacetPlanes = denseFacetPlanes;
+
+    ContourSet contours;
+    edgesSubPix( image, 2, 1.0, edgeDetector, 3, 20, 60, contours, options );
+
+    return contours;
+}
+} // namespace
+
+TEST( FacetPlanes, DensePlanesEqualPerPointFit )
+{
+    size_t numberPoints { };
+    size_t numberFlips { };
+
+    for ( const auto edgeDetector : { 0, 1 } )
+    {
+        SCOPED_TRACE( edgeDetector );
+
+        for ( int32_t i = 0; i < kNumberTestImages; i++ )
+        {
+            SCOPED_TRACE( i );
+
+            const auto image = syntheticImage( i );
+            const auto perPoint =
+                secondFacetContours( image, edgeDetector, false );
+            const auto dense = secondFacetContours( image, edgeDetector, true );
+
+            // The ordering does not depend on the extraction
+            ASSERT_EQ( dense.offsets, perPoint.offsets );
+
+            for ( size_t j = 0; j < perPoint.x.size( ); j++ )
+            {
+                SCOPED_TRACE( j );
+
+                numberPoints++;
+
+                if ( limitFlip( dense.x[ j ], perPoint.x[ j ] ) ||
+                     limitFlip( dense.y[ j ], perPoint.y[ j ] ) )
+                {
+                    numberFlips++;
+                    continue;
+                }
+
+                EXPECT_NEAR(
+                    dense.x[ j ], perPoint.x[ j ], kPositionTolerance );
+                EXPECT_NEAR(
+                    dense.y[ j ], perPoint.y[ j ], kPositionTolerance );
+                EXPECT_NEAR( dense.directionX[ j ],
+                             perPoint.directionX[ j ],
+                             kDirectionTolerance );
+                EXPECT_NEAR( dense.directionY[ j ],
+                             perPoint.directionY[ j ],
+                             kDirectionTolerance );
+
+                const auto responseTolerance =
+                    kRelativeResponseTolerance *
+                    std::max( 1.0f, std::fabs( perPoint.response[ j ] ) );
+                EXPECT_NEAR( dense.response[ j ],
+                             perPoint.response[ j ],
+                             responseTolerance );
+            }
+        }
+    }
+
+    // The flips are the exception
+    ASSERT_GT( numberPoints, 0u );
+    EXPECT_LT( numberFlips * 1000, numberPoints );
+}
@@ -0,0 +1,503 @@
+#include "EdgeBitmap.h"
+#include "Graph.h"
+#include "SubPixelDetection.h"
+#include "TestImages.h"
+
+// Std includes
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+// GTest includes
+#include <gtest/gtest.h>
+
+namespace
+{
+struct Edge
+{
+    int32_t u;
+    int32_t v;
+    int32_t weight;
+};
+
+// A graph as list of edges in the order they are added
+struct EdgeList
+{
+    int32_t numberVertices { };
+    std::vector< Edge > edges;
+};
+
+/*
+ * Function that returns the points of the components of the Canny edges of a
+ * synthetic image.
+ *
+ * @param [in]  index   The image index
+ *
+ * @returns The points of every component
+ */
+std::vector< std::vector< cv::Point2i > > contourComponents( int32_t index )
+{
+    std::pmr::vector< cv::Point2i > points;
+    std::pmr::vector< size_t > offsets;
+    labelContours( EdgeBitmap( cannyImage( index ) ), points, offsets );
+
+    std::vector< std::vector< cv::Point2i > > components;
+
+    for ( size_t i = 0; i + 1 < offsets.size( ); i++ )
+    {
+        components.emplace_back(
+            points.begin( ) + static_cast< std::ptrdiff_t >( offsets[ i ] ),
+            points.begin( ) +
+                static_cast< std::ptrdiff_t >( offsets[ i + 1 ] ) );
+    }
+
+    return components;
+}
+
+/*
+ * Function that creates the graph of a contour. Neighbouring points are
+ * connected by comparing all pairs, the weight is 1 for 4 and 2 for 8
+ * neighbours.
+ *
+ * @param [in]  points  The contour points
+ *
+ * @returns The graph
+ */
+EdgeList contourGraph( const std::vector< cv::Point2i >& points )
+{
+    EdgeList graph;
+    graph.numberVertices = static_cast< int32_t >( points.size( ) );
+
+    for ( size_t u = 0; u < points.size( ); u++ )
+    {
+        for ( size_t v = u + 1; v < points.size( ); v++ )
+        {
+            const auto dx = std::abs( points[ u ].x - points[ v ].x );
+            const auto dy = std::abs( points[ u ].y - points[ v ].y );
+
+            if ( dx <= 1 && dy <= 1 )
+            {
+                graph.edges.push_back( { static_cast< int32_t >( u ),
+                                         static_cast< int32_t >( v ),
+                                         dx + dy } );
+            }
+        }
+    }
+
+    return graph;
+}
+
+// The contour graphs of the components of a synthetic image
+std::vector< EdgeList > contourGraphs( int32_t index )
+{
+    std::vector< EdgeList > graphs;
+
+    for ( const auto& component : contourComponents( index ) )
+    {
+        graphs.push_back( contourGraph( component ) );
+    }
+
+    return graphs;
+}
+
+/*
+ * Function that creates a random connected graph. A random spanning tree is
+ * completed by random edges, the weights are in [1, maxWeight].
+ *
+ * @param [in]  seed        The seed
+ * @param [in]  maxWeight   The largest weight
+ * @param [in]  cycles      False to return the spanning tree only
+ *
+ * @returns The graph
+ */
+EdgeList randomGraph( uint32_t seed, int32_t maxWeight, bool cycles = true )
+{
+    std::mt19937 random( seed );
+
+    EdgeList graph;
+    graph.numberVertices = 50 + static_cast< int32_t >( random( ) % 200 );
+
+    const auto randomWeight = [ & ]( )
+    {
+        return 1 + static_cast< int32_t >(
+                       random( ) % static_cast< uint32_t >( maxWeight ) );
+    };
+
+    for ( int32_t v = 1; v < graph.numberVertices; v++ )
+    {
+        const auto u = static_cast< int32_t >(
+            random( ) % static_cast< uint32_t >( v ) );
+        graph.edges.push_back( { u, v, randomWeight( ) } );
+    }
+
+    if ( ! cycles )
+    {
+        return graph;
+    }
+
+    for ( int32_t i = 0; i < graph.numberVertices; i++ )
+    {
+        const auto u = static_cast< int32_t >(
+            random( ) % static_cast< uint32_t >( graph.numberVertices ) );
+        const auto v = static_cast< int32_t >(
+            random( ) % static_cast< uint32_t >( graph.numberVertices ) );
+
+        if ( u != v )
+        {
+            graph.edges.push_back( { u, v, randomWeight( ) } );
+        }
+    }
+
+    return graph;
+}
+
+// Adds the edges of the list to the graph
+void addEdges( const EdgeList& edgeList, Graph& graph )
+{
+    for ( const auto& edge : edgeList.edges )
+    {
+        graph.addEdge( edge.u, edge.v, edge.weight );
+    }
+}
+
+// The sources the paths are compared for
+std::vector< int32_t > testSources( int32_t numberVertices )
+{
+    return { 0, numberVertices / 2, numberVertices - 1 };
+}
+
+/*
+ * Function that compares Dial's algorithm with the binary heap. The graph
+ * selects Dial's algorithm for small weights, so the heap graph gets two
+ * extra vertices joined by a heavy edge. They cannot be reached from the
+ * other vertices and do not change their paths.
+ *
+ * @param [in]  edgeList    The graph, all weights in [1, 8]
+ */
+void expectDialEqualsHeap( const EdgeList& edgeList )
+{
+    const auto numberVertices = edgeList.numberVertices;
+
+    Graph dial( numberVertices );
+    addEdges( edgeList, dial );
+
+    Graph heap( numberVertices + 2 );
+    addEdges( edgeList, heap );
+    heap.addEdge( numberVertices, numberVertices + 1, 1000 );
+
+    for ( const auto source : testSources( numberVertices ) )
+    {
+        dial.shortestPath( source );
+        heap.shortestPath( source );
+
+        for ( size_t v = 0; v < static_cast< size_t >( numberVertices ); v++ )
+        {
+            ASSERT_EQ( dial.getShortestPath( v ), heap.getShortestPath( v ) )
+                << "source " << source << " destination " << v;
+        }
+    }
+}
+
+/*
+ * The graph before the compressed sparse rows. Every vertex has its own
+ * vector of neighbours and weights, the shortest paths come from a binary
+ * heap.
+ */
+class ReferenceGraph
+{
+public:
+    explicit ReferenceGraph( const EdgeList& edgeList )
+        : mAdjacency( static_cast< size_t >( edgeList.numberVertices ) )
+        , mParent( static_cast< size_t >( edgeList.numberVertices ) )
+    {
+        for ( const auto& edge : edgeList.edges )
+        {
+            mAdjacency[ static_cast< size_t >( edge.u ) ].emplace_back(
+                edge.v, edge.weight );
+            mAdjacency[ static_cast< size_t >( edge.v ) ].emplace_back(
+                edge.u, edge.weight );
+        }
+    }
+
+    void shortestPath( int32_t source )
+    {
+        using intPair = std::pair< int32_t, int32_t >;
+
+        mSource = static_cast< size_t >( source );
+
+        std::priority_queue< intPair,
+                             std::vector< intPair >,
+                             std::greater<> >
+            queue;
+
+        std::vector< int32_t > distances(
+            mAdjacency.size( ), std::numeric_limits< int32_t >::max( ) );
+
+        std::fill( mParent.begin( ), mParent.end( ), -1 );
+
+        queue.emplace( 0, source );
+        distances[ mSource ] = 0;
+
+        while ( ! queue.empty( ) )
+        {
+            const auto u = static_cast< size_t >( queue.top( ).second );
+            queue.pop( );
+
+            for ( const auto& [ v, weight ] : mAdjacency[ u ] )
+            {
+                const auto next = static_cast< size_t >( v );
+
+                if ( distances[ next ] > distances[ u ] + weight )
+                {
+                    distances[ next ] = distances[ u ] + weight;
+                    queue.emplace( distances[ next ], v );
+
+                    mParent[ next ] = static_cast< int32_t >( u );
+                }
+            }
+        }
+    }
+
+    std::vector< size_t > getShortestPath( size_t destination ) const
+    {
+        std::vector< size_t > path;
+
+        for ( auto vertex = destination; mParent[ vertex ] != -1;
+              vertex = static_cast< size_t >( mParent[ vertex ] ) )
+        {
+            path.insert( path.begin( ), vertex );
+        }
+
+        path.insert( path.begin( ), mSource );
+
+        return path;
+    }
+
+private:
+    std::vector< std::vector< std::pair< int32_t, int32_t > > > mAdjacency;
+    std::vector< int32_t > mParent;
+    size_t mSource { };
+};
+
+// Compares the paths of the graph with the ones of the reference graph
+void expectPathsEqualReference( Graph& graph, const EdgeList& edgeList )
+{
+    ReferenceGraph reference( edgeList );
+
+    for ( const auto source : testSources( edgeList.numberVertices ) )
+    {
+        graph.shortestPath( source );
+        reference.shortestPath( source );
+
+        for ( size_t v = 0;
+              v < static_cast< size_t >( edgeList.numberVertices );
+              v++ )
+        {
+            const auto& path = graph.getShortestPath( v );
+
+            ASSERT_EQ( std::vector< size_t >( path.begin( ), path.end( ) ),
+                       reference.getShortestPath( v ) )
+                << "source " << source << " destination " << v;
+        }
+    }
+}
+
+// Compares the tree paths with one search per pair on a graph without cycles
+void expectTreePathsEqualShortestPaths( const EdgeList& edgeList )
+{
+    Graph tree( edgeList.numberVertices );
+    addEdges( edgeList, tree );
+    tree.shortestPath( 0 );
+
+    Graph pairs( edgeList.numberVertices );
+    addEdges( edgeList, pairs );
+
+    for ( const auto from : testSources( edgeList.numberVertices ) )
+    {
+        pairs.shortestPath( from );
+
+        for ( size_t to = 0;
+              to < static_cast< size_t >( edgeList.numberVertices );
+              to++ )
+        {
+            std::pmr::vector< size_t > path;
+            tree.appendTreePath( static_cast< size_t >( from ), to, path );
+
+            ASSERT_EQ( path, pairs.getShortestPath( to ) )
+                << "from " << from << " to " << to;
+        }
+    }
+}
+
+/*
+ * Function that checks that the tree paths of a graph with cycles run from
+ * the first to the second vertex along edges of the graph and visit no
+ * vertex twice.
+ *
+ * @param [in]  edgeList    The graph
+ */
+void expectTreePathsConnect( const EdgeList& edgeList )
+{
+    const auto numberVertices =
+        static_cast< size_t >( edgeList.numberVertices );
+
+    std::set< std::pair< size_t, size_t > > edges;
+    for ( const auto& edge : edgeList.edges )
+    {
+        edges.emplace( edge.u, edge.v );
+        edges.emplace( edge.v, edge.u );
+    }
+
+    Graph graph( edgeList.numberVertices );
+    addEdges( edgeList, graph );
+    graph.shortestPath( 0 );
+
+    for ( const auto from : testSources( edgeList.numberVertices ) )
+    {
+        for ( size_t to = 0; to < numberVertices; to++ )
+        {
+            SCOPED_TRACE( to );
+
+            std::pmr::vector< size_t > path;
+            graph.appendTreePath( static_cast< size_t >( from ), to, path );
+
+            ASSERT_FALSE( path.empty( ) );
+            EXPECT_EQ( path.front( ), static_cast< size_t >( from ) );
+            EXPECT_EQ( path.back( ), to );
+
+            for ( size_t i = 0; i + 1 < path.size( ); i++ )
+            {
+                EXPECT_EQ( edges.count( { path[ i ], path[ i + 1 ] } ), 1u );
+            }
+
+            std::vector< size_t > vertices( path.begin( ), path.end( ) );
+            std::sort( vertices.begin( ), vertices.end( ) );
+            EXPECT_EQ( std::adjacent_find( vertices.begin( ), vertices.end( ) ),
+                       vertices.end( ) );
+        }
+    }
+}
+
+// Compares the graph of the edge list with the reference graph
+void expectEqualsReference( const EdgeList& edgeList )
+{
+    Graph graph( edgeList.numberVertices );
+    addEdges( edgeList, graph );
+
+    expectPathsEqualReference( graph, edgeList );
+}
+} // namespace
+
+TEST( Graph, DialEqualsHeapOnContourGraphs )
+{
+    for ( int32_t i = 0; i < kNumberTestImages; i++ )
+    {
+        SCOPED_TRACE( i );
+
+        for ( const auto& graph : contourGraphs( i ) )
+        {
+            expectDialEqualsHeap( graph );
+        }
+    }
+}
+
+TEST( Graph, DialEqualsHeapOnRandomGraphs )
+{
+    for ( uint32_t seed = 0; seed < 20; seed++ )
+    {
+        SCOPED_TRACE( seed );
+        expectDialEqualsHeap( randomGraph( seed, 8 ) );
+    }
+}
+
+TEST( Graph, ContourGraphsEqualAdjacencyLists )
+{
+    for ( int32_t i = 0; i < kNumberTestImages; i++ )
+    {
+        SCOPED_TRACE( i );
+
+        for ( const auto& graph : contourGraphs( i ) )
+        {
+            expectEqualsReference( graph );
+        }
+    }
+}
+
+TEST( Graph, AdjacencyMatrixEqualsPairwiseComparison )
+{
+    for ( int32_t i = 0; i < kNumberTestImages; i++ )
+    {
+        SCOPED_TRACE( i );
+
+        const auto size = cannyImage( i ).size( );
+        cv::Mat indexImage( size, CV_32SC1, cv::Scalar::all( -1 ) );
+
+        for ( const auto& component : contourComponents( i ) )
+        {
+            Graph graph( static_cast< int32_t >( component.size( ) ) );
+            calculateAdjacencyMatrix( component, indexImage, graph );
+
+            expectPathsEqualReference( graph, contourGraph( component ) );
+        }
+
+        // The index image is reset for the next contour
+        for ( int32_t y = 0; y < size.height; y++ )
+        {
+            for ( int32_t x = 0; x < size.width; x++ )
+            {
+                ASSERT_EQ( indexImage.ptr< int32_t >( y )[ x ], -1 );
+            }
+        }
+    }
+}
+
+TEST( Graph, TreePathsEqualShortestPathsWithoutCycles )
+{
+    for ( const auto maxWeight : { 2, 8, 50 } )
+    {
+        for ( uint32_t seed = 0; seed < 20; seed++ )
+        {
+            SCOPED_TRACE( seed );
+            expectTreePathsEqualShortestPaths(
+                randomGraph( seed, maxWeight, false ) );
+        }
+    }
+}
+
+TEST( Graph, TreePathsConnectTheVertices )
+{
+    for ( int32_t i = 0; i < kNumberTestImages; i++ )
+    {
+        SCOPED_TRACE( i );
+
+        for ( const auto& graph : contourGraphs( i ) )
+        {
+            expectTreePathsConnect( graph );
+        }
+    }
+
+    for ( uint32_t seed = 0; seed < 20; seed++ )
+    {
+        SCOPED_TRACE( seed );
+        expectTreePathsConnect( randomGraph( seed, 8 ) );
+    }
+}
+
+TEST( Graph, RandomGraphsEqualAdjacencyLists )
+{
+    // Up to 8 Dial's algorithm is used, above the heap
+    for ( const auto maxWeight : { 2, 8, 50 } )
+    {
+        for ( uint32_t seed = 0; seed < 20; seed++ )
+        {
+            SCOPED_TRACE( seed );
+            expectEqualsReference( randomGraph( seed, maxWeight ) );
+        }
+    }
+}
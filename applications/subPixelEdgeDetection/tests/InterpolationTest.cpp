@@ -0,0 +1,235 @@
+#include "NonMaximumSuppression.h"
+#include "SubPixelDetection.h"
+#include "TestImages.h"
+
+// Std includes
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// GTest includes
+#include <gtest/gtest.h>
+
+namespace
+{
+// Neighbour offsets along the quantized gradient direction
+constexpr std::array< int32_t, 4 > kStepX { { 1, 0, 1, 1 } };
+constexpr std::array< int32_t, 4 > kStepY { { 0, 1, 1, -1 } };
+
+struct SubPixelPoint
+{
+    float x;
+    float y;
+    float response;
+    float directionX;
+    float directionY;
+};
+
+// Returns the derivative at a position as float
+float derivativeValue( const cv::Mat& derivative, const cv::Point2i& pos )
+{
+    if ( derivative.depth( ) == CV_32F )
+    {
+        return derivative.ptr< float >( pos.y )[ pos.x ];
+    }
+
+    return static_cast< float >( derivative.ptr< int16_t >( pos.y )[ pos.x ] );
+}
+
+/*
+ * Function that quantizes a gradient direction by sign and ratio tests like
+ * the non maximum suppression. Int16 derivatives use the fixed point tangent
+ * of cv::Canny.
+ *
+ * @param [in]  derivativeX The derivative in x direction
+ * @param [in]  derivativeY The derivative in y direction
+ * @param [in]  pos         The position
+ *
+ * @returns The quantized direction
+ */
+uint8_t quantizeDirection( const cv::Mat& derivativeX,
+                           const cv::Mat& derivativeY, const cv::Point2i& pos )
+{
+    const auto gx = derivativeValue( derivativeX, pos );
+    const auto gy = derivativeValue( derivativeY, pos );
+
+    bool horizontal { };
+    bool vertical { };
+
+    if ( derivativeX.depth( ) == CV_16S )
+    {
+        // tan(22.5 degree) * 2^15 rounded
+        const auto xs = static_cast< int64_t >( std::fabs( gx ) );
+        const auto ys = static_cast< int64_t >( std::fabs( gy ) ) * 32768;
+        const auto tg22x = xs * 13573;
+
+        horizontal = ys < tg22x;
+        vertical = ys > tg22x + 65536 * xs;
+    }
+    else
+    {
+        // tan(22.5 degree)
+        const auto xs = std::fabs( gx );
+        const auto ys = std::fabs( gy );
+        const auto tg22x = xs * 0.4142135623730950488f;
+
+        horizontal = ys < tg22x;
+        vertical = ys > tg22x + 2.0f * xs;
+    }
+
+    if ( horizontal )
+    {
+        return kDirectionHorizontal;
+    }
+
+    if ( vertical )
+    {
+        return kDirectionVertical;
+    }
+
+    return ( gx < 0.0f ) != ( gy < 0.0f ) ? kDirectionAntiDiagonal
+                                          : kDirectionDiagonal;
+}
+
+/*
+ * Function that interpolates one point like before the blocks. The direction
+ * is quantized again from the derivatives and the parabola is fitted through
+ * the magnitudes of the pixel and its two neighbours along it.
+ *
+ * @param [in]  planes  The gradient planes
+ * @param [in]  pos     The edge pixel
+ *
+ * @returns The sub pixel point
+ */
+SubPixelPoint referenceInterpolation( const GradientPlanes& planes,
+                                      const cv::Point2i& pos )
+{
+    const auto& magnitude = planes.magnitude;
+
+    const auto gx = derivativeValue( planes.derivativeX, pos );
+    const auto gy = derivativeValue( planes.derivativeY, pos );
+    const auto norm = std::sqrt( gx * gx + gy * gy );
+
+    const auto edgeDir =
+        quantizeDirection( planes.derivativeX, planes.derivativeY, pos );
+    const auto stepX = kStepX[ edgeDir ];
+    const auto stepY = kStepY[ edgeDir ];
+
+    const auto xp = std::clamp( pos.x + stepX, 0, magnitude.cols - 1 );
+    const auto xm = std::clamp( pos.x - stepX, 0, magnitude.cols - 1 );
+    const auto yp = std::clamp( pos.y + stepY, 0, magnitude.rows - 1 );
+    const auto ym = std::clamp( pos.y - stepY, 0, magnitude.rows - 1 );
+
+    const auto Kp = magnitude.ptr< float >( yp )[ xp ];
+    const auto Km = magnitude.ptr< float >( ym )[ xm ];
+    const auto Ko = magnitude.ptr< float >( pos.y )[ pos.x ];
+
+    const auto top = Km - Kp;
+    const auto bottom = Km - 2.0f * Ko + Kp;
+
+    float n { };
+    if ( std::fabs( bottom ) > std::numeric_limits< float >::epsilon( ) )
+    {
+        n = 0.5f * top / bottom;
+    }
+
+    if ( std::fabs( n ) > 0.5f )
+    {
+        n = 0.0f;
+    }
+
+    SubPixelPoint point;
+    point.x = static_cast< float >( pos.x ) + n * static_cast< float >( stepX );
+    point.y = static_cast< float >( pos.y ) + n * static_cast< float >( stepY );
+    point.response = Ko;
+    point.directionX = norm > 0.0f ? gx / norm : 0.0f;
+    point.directionY = norm > 0.0f ? gy / norm : 0.0f;
+
+    return point;
+}
+
+// Returns all pixels the non maximum suppression kept
+std::vector< cv::Point2i > edgePixels( const GradientPlanes& planes )
+{
+    std::vector< cv::Point2i > points;
+
+    for ( int32_t y = 0; y < planes.edgeClasses.rows; y++ )
+    {
+        for ( int32_t x = 0; x < planes.edgeClasses.cols; x++ )
+        {
+            if ( planes.edgeClasses.ptr< uint8_t >( y )[ x ] != kNoEdge )
+            {
+                points.emplace_back( x, y );
+            }
+        }
+    }
+
+    return points;
+}
+
+// Compares the blocks with the per point reference on all edge pixels
+void expectBlocksEqualReference( const GradientPlanes& planes )
+{
+    const auto points = edgePixels( planes );
+    ASSERT_FALSE( points.empty( ) );
+
+    ContourSet contours;
+    extractSubPixelPositions(
+        planes, points.data( ), points.size( ), contours );
+    ASSERT_EQ( contours.x.size( ), points.size( ) );
+
+    for ( size_t i = 0; i < points.size( ); i++ )
+    {
+        SCOPED_TRACE( i );
+
+        const auto expected = referenceInterpolation( planes, points[ i ] );
+
+        EXPECT_FLOAT_EQ( contours.x[ i ], expected.x );
+        EXPECT_FLOAT_EQ( contours.y[ i ], expected.y );
+        EXPECT_FLOAT_EQ( contours.response[ i ], expected.response );
+        EXPECT_FLOAT_EQ( contours.directionX[ i ], expected.directionX );
+        EXPECT_FLOAT_EQ( contours.directionY[ i ], expected.directionY );
+    }
+}
+} // namespace
+
+TEST( Interpolation, BlocksEqualPerPointOnSobelPlanes )
+{
+    for ( int32_t i = 0; i < kNumberTestImages; i++ )
+    {
+        SCOPED_TRACE( i );
+
+        GradientPlanes planes;
+        sobelNonMaximumSuppression( syntheticImage( i ), 3, 20, 60, planes );
+
+        expectBlocksEqualReference( planes );
+    }
+}
+
+TEST( Interpolation, BlocksEqualPerPointOnFloatPlanes )
+{
+    for ( int32_t i = 0; i < kNumberTestImages; i++ )
+    {
+        SCOPED_TRACE( i );
+
+        GradientPlanes sobel;
+        sobelNonMaximumSuppression( syntheticImage( i ), 3, 20, 60, sobel );
+
+        cv::Mat derivativeX;
+        cv::Mat derivativeY;
+        sobel.derivativeX.convertTo( derivativeX, CV_32F, 0.25 );
+        sobel.derivativeY.convertTo( derivativeY, CV_32F, 0.25 );
+
+        GradientPlanes planes;
+        nonMaximumSuppression( derivativeX,
+                               derivativeY,
+                               5,
+                               15,
+                               planes,
+                               MagnitudeType::L2 );
+
+        expectBlocksEqualReference( planes );
+    }
+}
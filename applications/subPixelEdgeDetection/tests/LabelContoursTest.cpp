@@ -0,0 +1,169 @@
+#include "EdgeBitmap.h"
+#include "SubPixelDetection.h"
+#include "TestImages.h"
+
+// Std includes
+#include <memory>
+#include <vector>
+
+// GTest includes
+#include <gtest/gtest.h>
+
+namespace
+{
+/*
+ * Function that labels the contours like before the union find. Every
+ * provisional label owns a point vector. A merge copies the points of the
+ * other set behind the ones of the smaller label and makes all labels of the
+ * other set share the vector of the smaller one.
+ *
+ * @param [in]  imageIn The edge image (CV_8UC1)
+ *
+ * @return The points of every contour
+ */
+std::vector< std::vector< cv::Point2i > >
+referenceLabelContours( const cv::Mat& imageIn )
+{
+    std::vector< std::shared_ptr< std::vector< cv::Point2i > > > objects;
+    std::vector< int32_t > activeLabels;
+
+    int32_t labelNumber = 0;
+    std::vector< int32_t > neighbourhood( 4 );
+
+    cv::Mat labels(
+        imageIn.rows, imageIn.cols, CV_32SC1, cv::Scalar::all( 0 ) );
+
+    for ( auto y = 0; y < imageIn.rows; y++ )
+    {
+        for ( auto x = 0; x < imageIn.cols; x++ )
+        {
+            if ( imageIn.ptr< uint8_t >( y )[ x ] == 0 )
+            {
+                continue;
+            }
+
+            // |1|2|3|
+            // |0|c|x|
+            const auto top = y - 1 >= 0 ? y - 1 : y;
+            const auto left = x - 1 >= 0 ? x - 1 : x;
+            const auto right = x + 1 < labels.cols ? x + 1 : x;
+
+            neighbourhood[ 0 ] = labels.ptr< int32_t >( y )[ left ];
+            neighbourhood[ 1 ] = labels.ptr< int32_t >( top )[ left ];
+            neighbourhood[ 2 ] = labels.ptr< int32_t >( top )[ x ];
+            neighbourhood[ 3 ] = labels.ptr< int32_t >( top )[ right ];
+
+            int32_t minLabel = 0;
+            for ( const auto elem : neighbourhood )
+            {
+                if ( elem > 0 )
+                {
+                    const auto label =
+                        activeLabels[ static_cast< size_t >( elem - 1 ) ];
+
+                    if ( minLabel == 0 || label < minLabel )
+                    {
+                        minLabel = label;
+                    }
+                }
+            }
+
+            if ( minLabel == 0 )
+            {
+                labels.ptr< int32_t >( y )[ x ] = ++labelNumber;
+                objects.push_back(
+                    std::make_shared< std::vector< cv::Point2i > >( ) );
+                objects.back( )->emplace_back( x, y );
+                activeLabels.push_back( labelNumber );
+                continue;
+            }
+
+            labels.ptr< int32_t >( y )[ x ] = minLabel;
+
+            const auto newIndex = static_cast< size_t >( minLabel - 1 );
+            objects[ newIndex ]->emplace_back( x, y );
+
+            for ( const auto elem : neighbourhood )
+            {
+                if ( elem <= 0 )
+                {
+                    continue;
+                }
+
+                const auto oldIndex = static_cast< size_t >( elem - 1 );
+                const auto oldLabel = activeLabels[ oldIndex ];
+
+                if ( oldLabel == minLabel ||
+                     objects[ oldIndex ] == objects[ newIndex ] )
+                {
+                    continue;
+                }
+
+                objects[ newIndex ]->insert( objects[ newIndex ]->end( ),
+                                             objects[ oldIndex ]->begin( ),
+                                             objects[ oldIndex ]->end( ) );
+
+                for ( size_t i = 0; i < activeLabels.size( ); i++ )
+                {
+                    if ( activeLabels[ i ] == oldLabel )
+                    {
+                        activeLabels[ i ] = minLabel;
+                        objects[ i ] = objects[ newIndex ];
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector< std::vector< cv::Point2i > > contours;
+
+    for ( size_t i = 0; i < activeLabels.size( ); i++ )
+    {
+        if ( activeLabels[ i ] == static_cast< int32_t >( i ) + 1 )
+        {
+            contours.push_back( *objects[ i ] );
+        }
+    }
+
+    return contours;
+}
+
+// Compares the union find labeling with the reference on one image
+void expectSameLabels( const cv::Mat& image )
+{
+    std::pmr::vector< cv::Point2i > points;
+    std::pmr::vector< size_t > offsets;
+    labelContours( EdgeBitmap( image ), points, offsets );
+
+    const auto expected = referenceLabelContours( image );
+    ASSERT_EQ( offsets.size( ), expected.size( ) + 1 );
+
+    for ( size_t i = 0; i < expected.size( ); i++ )
+    {
+        ASSERT_EQ( offsets[ i + 1 ] - offsets[ i ], expected[ i ].size( ) );
+
+        for ( size_t j = 0; j < expected[ i ].size( ); j++ )
+        {
+            EXPECT_EQ( points[ offsets[ i ] + j ], expected[ i ][ j ] );
+        }
+    }
+}
+} // namespace
+
+TEST( LabelContours, CannyEdgesMatchCopyingLabeling )
+{
+    for ( int32_t i = 0; i < kNumberTestImages; i++ )
+    {
+        SCOPED_TRACE( i );
+        expectSameLabels( cannyImage( i ) );
+    }
+}
+
+TEST( LabelContours, BlobsMatchCopyingLabeling )
+{
+    for ( int32_t i = 0; i < kNumberTestImages; i++ )
+    {
+        SCOPED_TRACE( i );
+        expectSameLabels( blobImage( i ) );
+    }
+}
@@ -0,0 +1,121 @@
+#include "NonMaximumSuppression.h"
+#include "SubPixelDetection.h"
+#include "TestImages.h"
+#include "ThreadPool.h"
+
+// Std includes
+#include <vector>
+
+// GTest includes
+#include <gtest/gtest.h>
+
+namespace
+{
+// Number of workers, fixed so the points are split on every machine
+constexpr size_t kNumberThreads = 4;
+
+// Compares two contour sets element by element
+void expectSameContours( const ContourSet& lhs, const ContourSet& rhs )
+{
+    ASSERT_EQ( lhs.offsets, rhs.offsets );
+    EXPECT_EQ( lhs.x, rhs.x );
+    EXPECT_EQ( lhs.y, rhs.y );
+    EXPECT_EQ( lhs.response, rhs.response );
+    EXPECT_EQ( lhs.directionX, rhs.directionX );
+    EXPECT_EQ( lhs.directionY, rhs.directionY );
+}
+
+/*
+ * Function that runs the detection with and without a thread pool and
+ * compares the contours.
+ *
+ * @param [in]  edgeDetector    0 for Sobel, 1 for Deriche
+ * @param [in]  options         The pipeline options, without a pool
+ */
+void expectPoolEqualsSerial( int32_t edgeDetector,
+                             EdgeDetectionOptions options )
+{
+    ThreadPool threadPool( kNumberThreads );
+
+    for ( int32_t i = 0; i < kNumberTestImages; i++ )
+    {
+        SCOPED_TRACE( i );
+
+        const auto image = syntheticImage( i );
+
+        ContourSet serial;
+        options.threadPool = nullptr;
+        edgesSubPix( image, 2, 1.0, edgeDetector, 3, 20, 60, serial, options );
+
+        ContourSet parallel;
+        options.threadPool = &threadPool;
+        edgesSubPix(
+            image, 2, 1.0, edgeDetector, 3, 20, 60, parallel, options );
+
+        ASSERT_GT( serial.size( ), 0u );
+        expectSameContours( parallel, serial );
+    }
+}
+
+// The options of a subpixel method, the recursive blur needs no OpenCV blur
+EdgeDetectionOptions methodOptions( SubPixelMethod method )
+{
+    EdgeDetectionOptions options;
+    options.blurMethod = BlurMethod::Recursive;
+    options.subPixelMethod = method;
+
+    return options;
+}
+} // namespace
+
+TEST( ParallelExtraction, InterpolationPoolEqualsSerial )
+{
+    ThreadPool threadPool( kNumberThreads );
+
+    for ( int32_t i = 0; i < kNumberTestImages; i++ )
+    {
+        SCOPED_TRACE( i );
+
+        GradientPlanes planes;
+        sobelNonMaximumSuppression( syntheticImage( i ), 3, 20, 60, planes );
+
+        // Every pixel, so each worker gets several blocks
+        std::vector< cv::Point2i > points;
+        for ( int32_t y = 0; y < planes.edgeClasses.rows; y++ )
+        {
+            for ( int32_t x = 0; x < planes.edgeClasses.cols; x++ )
+            {
+                points.emplace_back( x, y );
+            }
+        }
+
+        ContourSet serial;
+        extractSubPixelPositions(
+            planes, points.data( ), points.size( ), serial );
+
+        ContourSet parallel;
+        extractSubPixelPositions(
+            planes, points.data( ), points.size( ), parallel, &threadPool );
+
+        expectSameContours( parallel, serial );
+    }
+}
+
+TEST( ParallelExtraction, EdgesSubPixPoolEqualsSerial )
+{
+    for ( const auto edgeDetector : { 0, 1 } )
+    {
+        SCOPED_TRACE( edgeDetector );
+
+        expectPoolEqualsSerial(
+            edgeDetector, methodOptions( SubPixelMethod::Interpolation ) );
+        expectPoolEqualsSerial( edgeDetector,
+                                methodOptions( SubPixelMethod::SecondFacet ) );
+        expectPoolEqualsSerial( edgeDetector,
+                                methodOptions( SubPixelMethod::Devernay ) );
+
+        auto denseOptions = methodOptions( SubPixelMethod::SecondFacet );
+        denseOptions.denseFacetPlanes = true;
+        expectPoolEqualsSerial( edgeDetector, denseOptions );
+    }
+}
@@ -0,0 +1,116 @@
+#include "RecursiveGaussian.h"
+#include "TestImages.h"
+#include "ThreadPool.h"
+
+// Std includes
+#include <algorithm>
+#include <cstdlib>
+
+// OpenCV includes
+#include <opencv2/imgproc.hpp>
+
+// GTest includes
+#include <gtest/gtest.h>
+
+namespace
+{
+// The blur sizes of the viewer trackbar
+constexpr int32_t kMaxBlurSize = 20;
+
+// Number of workers, fixed so the images are split on every machine
+constexpr size_t kNumberThreads = 4;
+
+// The synthetic images followed by the noise images
+cv::Mat testImage( int32_t index )
+{
+    return index < kNumberTestImages
+               ? syntheticImage( index )
+               : noiseImage( index - kNumberTestImages );
+}
+
+// The documented deviation from cv::GaussianBlur for a kernel size
+int32_t greyLevelBound( int32_t kernelSize )
+{
+    return kernelSize <= 5 ? 20 : 3;
+}
+
+// The largest absolute difference of two CV_8UC1 images
+int32_t maximumDifference( const cv::Mat& lhs, const cv::Mat& rhs )
+{
+    int32_t difference = 0;
+
+    for ( int32_t y = 0; y < lhs.rows; y++ )
+    {
+        for ( int32_t x = 0; x < lhs.cols; x++ )
+        {
+            difference = std::max(
+                difference,
+                std::abs( lhs.ptr< uint8_t >( y )[ x ] -
+                          rhs.ptr< uint8_t >( y )[ x ] ) );
+        }
+    }
+
+    return difference;
+}
+} // namespace
+
+TEST( RecursiveGaussian, MatchesGaussianBlur )
+{
+    for ( int32_t blurSize = 1; blurSize <= kMaxBlurSize; blurSize++ )
+    {
+        SCOPED_TRACE( blurSize );
+
+        const auto kernelSize = 2 * blurSize + 1;
+
+        for ( int32_t i = 0; i < 2 * kNumberTestImages; i++ )
+        {
+            SCOPED_TRACE( i );
+
+            const auto image = testImage( i );
+
+            cv::Mat recursive;
+            recursiveGaussianBlur(
+                image, recursive, gaussianSigma( kernelSize ) );
+
+            cv::Mat expected;
+            cv::GaussianBlur( image,
+                              expected,
+                              cv::Size( kernelSize, kernelSize ),
+                              0,
+                              0,
+                              cv::BORDER_REPLICATE );
+
+            ASSERT_EQ( recursive.type( ), CV_8UC1 );
+            ASSERT_EQ( recursive.size( ), image.size( ) );
+            EXPECT_LE( maximumDifference( recursive, expected ),
+                       greyLevelBound( kernelSize ) );
+        }
+    }
+}
+
+TEST( RecursiveGaussian, PoolEqualsSerial )
+{
+    ThreadPool threadPool( kNumberThreads );
+
+    for ( const auto blurSize : { 1, 5, kMaxBlurSize } )
+    {
+        SCOPED_TRACE( blurSize );
+
+        const auto sigma = gaussianSigma( 2 * blurSize + 1 );
+
+        for ( int32_t i = 0; i < 2 * kNumberTestImages; i++ )
+        {
+            SCOPED_TRACE( i );
+
+            const auto image = testImage( i );
+
+            cv::Mat serial;
+            recursiveGaussianBlur( image, serial, sigma );
+
+            cv::Mat parallel;
+            recursiveGaussianBlur( image, parallel, sigma, &threadPool );
+
+            EXPECT_EQ( maximumDifference( parallel, serial ), 0 );
+        }
+    }
+}
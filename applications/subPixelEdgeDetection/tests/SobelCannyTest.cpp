@@ -0,0 +1,150 @@
+#include "EdgeBitmap.h"
+#include "NonMaximumSuppression.h"
+#include "TestImages.h"
+
+// Std includes
+#include <array>
+
+// GTest includes
+#include <gtest/gtest.h>
+
+namespace
+{
+struct ApertureCase
+{
+    int32_t apertureSize;
+    double lowThreshold;
+    double highThreshold;
+};
+
+// The thresholds grow with the gain of the larger kernels
+constexpr std::array< ApertureCase, 3 > kApertureCases { {
+    { 3, 20, 60 },
+    { 5, 240, 720 },
+    { 7, 3200, 9600 },
+} };
+
+// The synthetic images followed by the noise images
+cv::Mat testImage( int32_t index )
+{
+    return index < kNumberTestImages
+               ? syntheticImage( index )
+               : noiseImage( index - kNumberTestImages );
+}
+
+// Compares two images of the same type element by element
+template < typename T >
+void expectSameImage( const cv::Mat& actual, const cv::Mat& expected )
+{
+    ASSERT_EQ( actual.type( ), expected.type( ) );
+    ASSERT_EQ( actual.size( ), expected.size( ) );
+
+    for ( int32_t y = 0; y < expected.rows; y++ )
+    {
+        for ( int32_t x = 0; x < expected.cols; x++ )
+        {
+            ASSERT_EQ( actual.ptr< T >( y )[ x ], expected.ptr< T >( y )[ x ] )
+                << "x " << x << " y " << y;
+        }
+    }
+}
+} // namespace
+
+TEST( SobelCanny, DerivativesMatchSobel )
+{
+    for ( const auto& apertureCase : kApertureCases )
+    {
+        SCOPED_TRACE( apertureCase.apertureSize );
+
+        for ( int32_t i = 0; i < 2 * kNumberTestImages; i++ )
+        {
+            SCOPED_TRACE( i );
+
+            const auto image = testImage( i );
+
+            GradientPlanes planes;
+            sobelNonMaximumSuppression( image,
+                                        apertureCase.apertureSize,
+                                        apertureCase.lowThreshold,
+                                        apertureCase.highThreshold,
+                                        planes );
+
+            cv::Mat derivativeX;
+            cv::Mat derivativeY;
+            cv::Sobel(
+                image, derivativeX, CV_16S, 1, 0, apertureCase.apertureSize );
+            cv::Sobel(
+                image, derivativeY, CV_16S, 0, 1, apertureCase.apertureSize );
+
+            expectSameImage< int16_t >( planes.derivativeX, derivativeX );
+            expectSameImage< int16_t >( planes.derivativeY, derivativeY );
+        }
+    }
+}
+
+TEST( SobelCanny, EdgesMatchCanny )
+{
+    for ( const auto magnitudeType : { MagnitudeType::L1, MagnitudeType::L2 } )
+    {
+        SCOPED_TRACE( magnitudeType == MagnitudeType::L2 ? "L2" : "L1" );
+
+        for ( const auto& apertureCase : kApertureCases )
+        {
+            SCOPED_TRACE( apertureCase.apertureSize );
+
+            for ( int32_t i = 0; i < 2 * kNumberTestImages; i++ )
+            {
+                SCOPED_TRACE( i );
+
+                const auto image = testImage( i );
+
+                GradientPlanes planes;
+                sobelNonMaximumSuppression( image,
+                                            apertureCase.apertureSize,
+                                            apertureCase.lowThreshold,
+                                            apertureCase.highThreshold,
+                                            planes,
+                                            magnitudeType );
+
+                EdgeBitmap edges;
+                hysteresis( planes.edgeClasses, edges );
+
+                cv::Mat derivativeX;
+                cv::Mat derivativeY;
+                cv::Sobel( image,
+                           derivativeX,
+                           CV_16S,
+                           1,
+                           0,
+                           apertureCase.apertureSize );
+                cv::Sobel( image,
+                           derivativeY,
+                           CV_16S,
+                           0,
+                           1,
+                           apertureCase.apertureSize );
+
+                cv::Mat cannyEdges;
+                cv::Canny( derivativeX,
+                           derivativeY,
+                           cannyEdges,
+                           apertureCase.lowThreshold,
+                           apertureCase.highThreshold,
+                           magnitudeType == MagnitudeType::L2 );
+
+                // The hysteresis removes the redundant pixels of the Canny
+                // edges, the same removal on them has to give the same edges
+                EdgeBitmap expectedEdges( cannyEdges );
+                expectedEdges.removeRedundantPixels( );
+
+                cv::Mat actual;
+                cv::Mat expected;
+                edges.copyTo( actual );
+                expectedEdges.copyTo( expected );
+
+                ASSERT_GT( cv::countNonZero( expected ), 0 );
+                expectSameImage< uint8_t >( actual, expected );
+            }
+        }
+    }
+}
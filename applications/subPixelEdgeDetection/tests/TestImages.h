@@ -0,0 +1,152 @@
+#pragma once
+
+// Std includes
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+// OpenCV includes
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+// Number of synthetic images every comparison runs on
+constexpr int32_t kNumberTestImages = 8;
+
+/*
+ * Function that creates a synthetic gray image. A bright ellipse is crossed
+ * by thin diagonal stripes, which gives closed contours, open lines and
+ * junctions. Every second image gets salt noise for short scattered edges.
+ *
+ * @param [in]  index   The image index, also the seed of the noise
+ *
+ * @returns The image (CV_8UC1)
+ */
+inline cv::Mat syntheticImage( int32_t index )
+{
+    std::mt19937 random( static_cast< uint32_t >( index ) );
+
+    const auto width = 40 + static_cast< int32_t >( random( ) % 90 );
+    const auto height = 40 + static_cast< int32_t >( random( ) % 90 );
+    const auto period = 11 + index % 3 * 6;
+
+    const auto centerX = width * 0.45;
+    const auto centerY = height * 0.55;
+    const auto radiusX = width * 0.3;
+    const auto radiusY = height * 0.25;
+
+    cv::Mat image( height, width, CV_8UC1 );
+
+    for ( int32_t y = 0; y < height; y++ )
+    {
+        const auto rowPtr = image.ptr< uint8_t >( y );
+
+        for ( int32_t x = 0; x < width; x++ )
+        {
+            const auto dx = ( x - centerX ) / radiusX;
+            const auto dy = ( y - centerY ) / radiusY;
+
+            int32_t value = dx * dx + dy * dy < 1.0 ? 190 : 50;
+
+            if ( ( x + 2 * y ) % period < 2 )
+            {
+                value = 120;
+            }
+
+            if ( index % 2 == 1 && random( ) % 9 == 0 )
+            {
+                value = static_cast< int32_t >( random( ) % 256 );
+            }
+
+            rowPtr[ x ] = static_cast< uint8_t >( value );
+        }
+    }
+
+    return image;
+}
+
+/*
+ * Function that runs cv::Canny on a synthetic image.
+ *
+ * @param [in]  index   The image index
+ *
+ * @returns The edges (CV_8UC1, 0 or 255)
+ */
+inline cv::Mat cannyImage( int32_t index )
+{
+    cv::Mat edges;
+    cv::Canny( syntheticImage( index ), edges, 20, 60, 3 );
+
+    return edges;
+}
+
+/*
+ * Function that creates a binary image of random overlapping rectangles. The
+ * blobs are several pixels thick, so the thinning has to delete from both
+ * sides and the labeling merges many provisional labels.
+ *
+ * @param [in]  index   The image index, also the seed
+ *
+ * @returns The image (CV_8UC1, 0 or 255)
+ */
+inline cv::Mat blobImage( int32_t index )
+{
+    std::mt19937 random( static_cast< uint32_t >( 1000 + index ) );
+
+    const auto width = 30 + static_cast< int32_t >( random( ) % 100 );
+    const auto height = 30 + static_cast< int32_t >( random( ) % 100 );
+
+    cv::Mat image( height, width, CV_8UC1, cv::Scalar::all( 0 ) );
+
+    for ( int32_t i = 0; i < width * height / 60; i++ )
+    {
+        const auto x0 = static_cast< int32_t >(
+            random( ) % static_cast< uint32_t >( width ) );
+        const auto y0 = static_cast< int32_t >(
+            random( ) % static_cast< uint32_t >( height ) );
+        const auto x1 = std::min( width, x0 + 1 + static_cast< int32_t >(
+                                                      random( ) % 9 ) );
+        const auto y1 = std::min( height, y0 + 1 + static_cast< int32_t >(
+                                                       random( ) % 9 ) );
+
+        for ( auto y = y0; y < y1; y++ )
+        {
+            std::fill( image.ptr< uint8_t >( y ) + x0,
+                       image.ptr< uint8_t >( y ) + x1,
+                       uint8_t { 255 } );
+        }
+    }
+
+    return image;
+}
+
+/*
+ * Function that creates an image of uniform noise. Its gradients take every
+ * direction and size, so the direction quantization and the magnitude ties
+ * are hit far more often than on the synthetic images.
+ *
+ * @param [in]  index   The image index, also the seed
+ *
+ * @returns The image (CV_8UC1)
+ */
+inline cv::Mat noiseImage( int32_t index )
+{
+    std::mt19937 random( static_cast< uint32_t >( 2000 + index ) );
+
+    const auto width = 40 + static_cast< int32_t >( random( ) % 90 );
+    const auto height = 40 + static_cast< int32_t >( random( ) % 90 );
+
+    cv::Mat image( height, width, CV_8UC1 );
+
+    for ( int32_t y = 0; y < height; y++ )
+    {
+        const auto rowPtr = image.ptr< uint8_t >( y );
+
+        for ( int32_t x = 0; x < width; x++ )
+        {
+            rowPtr[ x ] = static_cast< uint8_t >( random( ) % 256 );
+        }
+    }
+
+    return image;
+}
@@ -0,0 +1,187 @@
+#include "EdgeBitmap.h"
+#include "NonMaximumSuppression.h"
+#include "TestImages.h"
+
+// Std includes
+#include <array>
+
+// GTest includes
+#include <gtest/gtest.h>
+
+namespace
+{
+/*
+ * Function that runs one Zhang-Suen sub iteration on a byte image. The pixels
+ * are tested on imageA and deleted in imageB.
+ *
+ * @param [in]  imageA      The image of the pixels tested
+ * @param [out] imageB      The image the pixels are deleted in
+ * @param [in]  iteration   The sub iteration, 0 or 1
+ *
+ * @returns The number of deleted pixels
+ */
+int32_t referenceThinningIteration( const cv::Mat& imageA, cv::Mat& imageB,
+                                    int32_t iteration )
+{
+    int32_t changedPixels { };
+
+    for ( int32_t y = 1; y < imageA.rows - 1; y++ )
+    {
+        const auto rowPtrYM1 = imageA.ptr< uint8_t >( y - 1 );
+        const auto rowPtrY = imageA.ptr< uint8_t >( y );
+        const auto rowPtrYP1 = imageA.ptr< uint8_t >( y + 1 );
+
+        for ( int32_t x = 1; x < imageA.cols - 1; x++ )
+        {
+            if ( rowPtrY[ x ] == 0 )
+            {
+                continue;
+            }
+
+            //  0  1  2  3  4  5  6  7  8
+            //  P1 P2 P3 P4 P5 P6 P7 P8 P9
+            const std::array< int32_t, 9 > p { 1,
+                                               rowPtrYM1[ x ] != 0,
+                                               rowPtrYM1[ x + 1 ] != 0,
+                                               rowPtrY[ x + 1 ] != 0,
+                                               rowPtrYP1[ x + 1 ] != 0,
+                                               rowPtrYP1[ x ] != 0,
+                                               rowPtrYP1[ x - 1 ] != 0,
+                                               rowPtrY[ x - 1 ] != 0,
+                                               rowPtrYM1[ x - 1 ] != 0 };
+
+            // P2 P3 P4 P5 P6 P7 P8 P9 P2
+            int32_t transitions { };
+            int32_t sum { };
+            for ( size_t i = 1; i < 9; i++ )
+            {
+                const auto next = i < 8 ? i + 1 : 1;
+                transitions += p[ i ] == 0 && p[ next ] != 0;
+                sum += p[ i ];
+            }
+
+            const auto m1 = iteration == 0 ? p[ 1 ] * p[ 3 ] * p[ 5 ]
+                                           : p[ 1 ] * p[ 3 ] * p[ 7 ];
+            const auto m2 = iteration == 0 ? p[ 3 ] * p[ 5 ] * p[ 7 ]
+                                           : p[ 1 ] * p[ 5 ] * p[ 7 ];
+
+            if ( transitions == 1 && sum >= 2 && sum <= 6 && m1 == 0 &&
+                 m2 == 0 )
+            {
+                imageB.ptr< uint8_t >( y )[ x ] = 0;
+                changedPixels++;
+            }
+        }
+    }
+
+    return changedPixels;
+}
+
+/*
+ * Function that thins a byte image with full frame passes, like before the
+ * edge bitmap.
+ *
+ * @param [in]  imageIn         The image (CV_8UC1, 0 or 255)
+ * @param [out] deletedPixels   The number of deleted pixels
+ *
+ * @returns The thinned image
+ */
+cv::Mat referenceThinning( const cv::Mat& imageIn, size_t& deletedPixels )
+{
+    cv::Mat workImageA;
+    cv::copyMakeBorder( imageIn,
+                        workImageA,
+                        1,
+                        1,
+                        1,
+                        1,
+                        cv::BORDER_CONSTANT,
+                        cv::Scalar::all( 0 ) );
+
+    cv::Mat workImageB = workImageA.clone( );
+
+    deletedPixels = 0;
+    int32_t changedPixels;
+
+    do
+    {
+        changedPixels = referenceThinningIteration( workImageA, workImageB, 0 );
+        workImageB.copyTo( workImageA );
+
+        changedPixels +=
+            referenceThinningIteration( workImageB, workImageA, 1 );
+        workImageA.copyTo( workImageB );
+
+        deletedPixels += static_cast< size_t >( changedPixels );
+    } while ( changedPixels > 0 );
+
+    return workImageA( cv::Rect( 1, 1, imageIn.cols, imageIn.rows ) ).clone( );
+}
+
+// Compares the bitmap thinning with the reference on one image
+void expectSameThinning( const cv::Mat& image )
+{
+    size_t expectedDeleted { };
+    const auto expected = referenceThinning( image, expectedDeleted );
+
+    EdgeBitmap edges( image );
+    const auto deleted = edges.thin( );
+
+    cv::Mat thinned;
+    edges.copyTo( thinned );
+
+    EXPECT_EQ( deleted, expectedDeleted );
+    ASSERT_EQ( thinned.size( ), expected.size( ) );
+
+    for ( int32_t y = 0; y < expected.rows; y++ )
+    {
+        for ( int32_t x = 0; x < expected.cols; x++ )
+        {
+            EXPECT_EQ( thinned.ptr< uint8_t >( y )[ x ],
+                       expected.ptr< uint8_t >( y )[ x ] )
+                << "x " << x << " y " << y;
+        }
+    }
+}
+} // namespace
+
+TEST( Thinning, CannyEdgesMatchByteThinning )
+{
+    for ( int32_t i = 0; i < kNumberTestImages; i++ )
+    {
+        SCOPED_TRACE( i );
+        expectSameThinning( cannyImage( i ) );
+    }
+}
+
+TEST( Thinning, BlobsMatchByteThinning )
+{
+    for ( int32_t i = 0; i < kNumberTestImages; i++ )
+    {
+        SCOPED_TRACE( i );
+        expectSameThinning( blobImage( i ) );
+    }
+}
+
+TEST( Thinning, DeletesNothingAfterHysteresis )
+{
+    for ( int32_t i = 0; i < kNumberTestImages; i++ )
+    {
+        SCOPED_TRACE( i );
+
+        GradientPlanes planes;
+        sobelNonMaximumSuppression( syntheticImage( i ), 3, 20, 60, planes );
+
+        EdgeBitmap edges;
+        hysteresis( planes.edgeClasses, edges );
+
+        EXPECT_EQ( edges.thin( ), 0u );
+
+        // The edge image of the viewer comes from the same flood fill
+        cv::Mat edgeImage;
+        hysteresis( planes.edgeClasses, edgeImage );
+
+        EdgeBitmap imageEdges( edgeImage );
+        EXPECT_EQ( imageEdges.thin( ), 0u );
+    }
+}
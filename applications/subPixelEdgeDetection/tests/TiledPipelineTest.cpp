@@ -0,0 +1,109 @@
+#include "SubPixelDetection.h"
+#include "TestImages.h"
+#include "ThreadPool.h"
+
+// Std includes
+#include <array>
+
+// GTest includes
+#include <gtest/gtest.h>
+
+namespace
+{
+// Number of workers, fixed so the tiles are split on every machine
+constexpr size_t kNumberThreads = 4;
+
+// Tile sizes from single pixels to tiles larger than some of the images
+constexpr std::array< int32_t, 5 > kTileSizes { 1, 3, 16, 37, 64 };
+
+struct PipelineCase
+{
+    int32_t edgeDetector;
+    int32_t apertureSize;
+    int32_t blurSize;
+    BlurMethod blurMethod;
+    MagnitudeType magnitudeType;
+    double lowThreshold;
+    double highThreshold;
+};
+
+// The thresholds grow with the gain of the larger kernels
+const std::array< PipelineCase, 7 > kPipelineCases { {
+    { 0, 3, 2, BlurMethod::Gaussian, MagnitudeType::L1, 20, 60 },
+    { 0, 3, 0, BlurMethod::Gaussian, MagnitudeType::L2, 20, 60 },
+    { 0, 5, 1, BlurMethod::Gaussian, MagnitudeType::L1, 240, 720 },
+    { 0, 7, 3, BlurMethod::Gaussian, MagnitudeType::L2, 3200, 9600 },
+    { 0, -1, 2, BlurMethod::Gaussian, MagnitudeType::L1, 80, 240 },
+    { 0, 3, 2, BlurMethod::Recursive, MagnitudeType::L1, 20, 60 },
+    { 1, 3, 2, BlurMethod::Gaussian, MagnitudeType::L2, 20, 60 },
+} };
+
+// Compares two contour sets element by element
+void expectSameContours( const ContourSet& lhs, const ContourSet& rhs )
+{
+    ASSERT_EQ( lhs.offsets, rhs.offsets );
+    EXPECT_EQ( lhs.x, rhs.x );
+    EXPECT_EQ( lhs.y, rhs.y );
+    EXPECT_EQ( lhs.response, rhs.response );
+    EXPECT_EQ( lhs.directionX, rhs.directionX );
+    EXPECT_EQ( lhs.directionY, rhs.directionY );
+}
+
+// Runs the detection of a case with the given tile size
+ContourSet detect( const cv::Mat& image, const PipelineCase& pipelineCase,
+                   int32_t tileSize, ThreadPool* threadPool )
+{
+    EdgeDetectionOptions options;
+    options.blurMethod = pipelineCase.blurMethod;
+    options.magnitudeType = pipelineCase.magnitudeType;
+    options.tileSize = tileSize;
+    options.threadPool = threadPool;
+
+    ContourSet contours;
+    edgesSubPix( image,
+                 pipelineCase.blurSize,
+                 1.0,
+                 pipelineCase.edgeDetector,
+                 pipelineCase.apertureSize,
+                 pipelineCase.lowThreshold,
+                 pipelineCase.highThreshold,
+                 contours,
+                 options );
+
+    return contours;
+}
+} // namespace
+
+TEST( TiledPipeline, TilesEqualWholeFrame )
+{
+    ThreadPool threadPool( kNumberThreads );
+
+    for ( size_t c = 0; c < kPipelineCases.size( ); c++ )
+    {
+        SCOPED_TRACE( c );
+
+        const auto& pipelineCase = kPipelineCases[ c ];
+
+        for ( int32_t i = 0; i < kNumberTestImages; i++ )
+        {
+            SCOPED_TRACE( i );
+
+            const auto image = syntheticImage( i );
+            const auto expected = detect( image, pipelineCase, 0, nullptr );
+            ASSERT_GT( expected.size( ), 0u );
+
+            for ( const auto tileSize : kTileSizes )
+            {
+                SCOPED_TRACE( tileSize );
+
+                expectSameContours(
+                    detect( image, pipelineCase, tileSize, &threadPool ),
+                    expected );
+            }
+
+            // The tiles do not depend on the pool
+            expectSameContours( detect( image, pipelineCase, 16, nullptr ),
+                                expected );
+        }
+    }
+}